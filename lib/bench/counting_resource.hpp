@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory_resource>
+#include <cstddef>
+
+/**
+ * Memory resource which counts the allocations passed on to its upstream resource.
+ * Used by the benchmarks, not thread-safe.
+ */
+class CountingResource final : public std::pmr::memory_resource
+{
+public:
+    explicit CountingResource(std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+        : _upstream(upstream)
+    {}
+
+    // amount of allocations and allocated bytes since the last reset()
+    inline std::size_t allocations() const
+    { return this->_allocations; }
+    inline std::size_t bytes() const
+    { return this->_bytes; }
+
+    inline void reset()
+    {
+        this->_allocations = 0;
+        this->_bytes = 0;
+    }
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        ++this->_allocations;
+        this->_bytes += bytes;
+        return this->_upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+    { this->_upstream->deallocate(p, bytes, alignment); }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    { return this == &other; }
+
+    std::pmr::memory_resource *_upstream;
+    std::size_t _allocations = 0;
+    std::size_t _bytes = 0;
+};
@@ -0,0 +1,151 @@
+// Compares the allocations of Database::findAll() with the default memory
+// resource against findAll() with a std::pmr::monotonic_buffer_resource.
+//
+// Requires a MariaDB server, the connection is configured with the environment
+// variables AWESOMEDB_BENCH_HOST, AWESOMEDB_BENCH_USERNAME, AWESOMEDB_BENCH_PASSWORD
+// and AWESOMEDB_BENCH_DATABASE. The amount of rows can be given as argument.
+// The table "awesomedb_bench_records" is created and dropped again.
+
+#include "counting_resource.hpp"
+
+#include <database/database.hpp>
+
+#include <new>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <memory_resource>
+
+#include <fmt/format.h>
+
+namespace {
+
+// all heap allocations of the process, including the ones outside of std::pmr
+std::size_t heap_allocations = 0;
+
+}
+
+void *operator new(std::size_t size)
+{
+    ++heap_allocations;
+    if (void *p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{ std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept
+{ std::free(p); }
+
+MODEL(BenchRecord)
+{
+    MODEL_DECL(BenchRecord, "awesomedb_bench_records");
+    MODEL_ATTRIBUTE(name, std::string);
+    MODEL_ATTRIBUTE(description, std::string);
+    MODEL_ATTRIBUTE(score, std::optional<std::int32_t>);
+};
+
+BenchRecord::BenchRecord()
+{
+    this->make_model_attribute<std::string>("name");
+    this->make_model_attribute<std::string>("description");
+    this->make_model_attribute<std::optional<std::int32_t>>("score");
+}
+
+BenchRecord::BenchRecord(const Query *query, const Database *db)
+    : BenchRecord()
+{
+    this->construct_default(query);
+}
+
+MODEL_DEFAULT_VALID_IMPL(BenchRecord);
+
+namespace {
+
+std::string environment(const char *name)
+{
+    const auto value = std::getenv(name);
+    return value ? value : "";
+}
+
+template<typename Function>
+void run(std::string_view name, CountingResource &counting, Function &&function)
+{
+    counting.reset();
+    const auto heap = heap_allocations;
+    const auto start = std::chrono::steady_clock::now();
+
+    const auto rows = function();
+
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    fmt::print("{:<24} {:>8} rows {:>10} pmr allocations {:>12} pmr bytes {:>10} heap allocations {:>10.2f} ms\n",
+        name, rows, counting.allocations(), counting.bytes(), heap_allocations - heap, elapsed.count());
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const std::size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100'000;
+
+    DatabaseConfig config;
+    config.host = environment("AWESOMEDB_BENCH_HOST");
+    config.username = environment("AWESOMEDB_BENCH_USERNAME");
+    config.password = environment("AWESOMEDB_BENCH_PASSWORD");
+    config.database = environment("AWESOMEDB_BENCH_DATABASE");
+    if (config.host.empty())
+    {
+        config.host = "127.0.0.1";
+    }
+
+    Database::registerModel<BenchRecord>();
+    Database db{config};
+    const std::string table{BenchRecord::tableName()};
+    if (!db.createTable<BenchRecord>() || !db.truncateTable(table))
+    {
+        fmt::print("failed to create the benchmark table: {}\n", db.lastErrorMessage());
+        return 1;
+    }
+
+    {
+        std::vector<BenchRecord> records(rows);
+        for (std::size_t i = 0; i < rows; ++i)
+        {
+            records[i].set_name(fmt::format("record {}", i));
+            records[i].set_description("a description long enough to not fit into the small string buffer");
+            records[i].set_score(static_cast<std::int32_t>(i));
+        }
+        if (!db.saveRecords(records))
+        {
+            fmt::print("failed to insert the benchmark records: {}\n", db.lastErrorMessage());
+            db.dropTable(table);
+            return 1;
+        }
+    }
+
+    // pmr allocations of the default path are counted through the default resource
+    CountingResource counting;
+    const auto previous = std::pmr::set_default_resource(&counting);
+
+    run("findAll", counting, [&]{
+        return db.findAll<BenchRecord>().size();
+    });
+
+    run("findAll (monotonic)", counting, [&]{
+        std::pmr::monotonic_buffer_resource arena{&counting};
+        return db.findAll<BenchRecord>(&arena).size();
+    });
+
+    std::pmr::set_default_resource(previous);
+
+    db.dropTable(table);
+    return 0;
+}
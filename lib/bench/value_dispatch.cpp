@@ -0,0 +1,66 @@
+// Compares the per-value dispatch of the built-in attribute types through
+// utils::Value against the runtime registry lookup on std::any, which was
+// used for all attribute values before.
+
+#include <utils/value.hpp>
+#include <utils/any_comparator.hpp>
+#include <utils/any_formatter.hpp>
+#include <utils/qvariant_converter.hpp>
+
+#include <any>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <fmt/format.h>
+
+namespace {
+
+constexpr std::size_t iterations = 1'000'000;
+
+// keeps the compiler from dropping the benchmarked calls
+volatile std::size_t sink = 0;
+
+inline void consume(std::size_t value)
+{ sink = sink + value; }
+
+template<typename Function>
+void run(std::string_view name, Function &&function)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i)
+    {
+        function(i);
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    fmt::print("{:<40} {:>8.2f} ns/value\n", name, elapsed.count() / iterations);
+}
+
+template<typename T>
+void bench(std::string_view type, const T &l, const T &r)
+{
+    const utils::Value lv = l, rv = r;
+    const std::any la = l, ra = r;
+
+    fmt::print("{}\n", type);
+    run("  compare_value", [&](std::size_t){ consume(utils::compare_value(lv, rv)); });
+    run("  compare_any (registry)", [&](std::size_t){ consume(utils::compare_any(la, ra)); });
+    run("  format_value", [&](std::size_t){ consume(utils::format_value(lv).size()); });
+    run("  format_any (registry)", [&](std::size_t){ consume(utils::format_any(la).size()); });
+    run("  qvariant_from_value", [&](std::size_t){ consume(utils::qvariant_from_value(lv).isValid()); });
+    run("  qvariant_from_any (registry)", [&](std::size_t){ consume(utils::qvariant_from_any(la).isValid()); });
+}
+
+}
+
+int main()
+{
+    bench<std::int64_t>("std::int64_t", 42, 43);
+    bench<double>("double", 4.2, 4.3);
+    bench<std::string>("std::string", "awesome", "awesomer");
+    bench<std::optional<std::int32_t>>("std::optional<std::int32_t>", 42, std::nullopt);
+    bench<QDateTime>("QDateTime", QDateTime::fromSecsSinceEpoch(0), QDateTime::fromSecsSinceEpoch(1));
+    return 0;
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <utility>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include <utils/value.hpp>
+
+class Database;
+struct ColumnBufferTest;
+
+/**
+ * Column types supported by Database::findColumns().
+ * bool columns can be read as std::uint8_t.
+ */
+template<typename T>
+concept ColumnType = utils::is_builtin_value_v<std::optional<T>> &&
+    ((std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) || std::is_same_v<T, std::string>);
+
+/**
+ * Contiguous values of a single result column with a null bitmap.
+ * NULL values are stored as default constructed values.
+ */
+template<ColumnType T>
+class ColumnBuffer final
+{
+public:
+    using value_type = T;
+
+    // widened result type of sum()
+    using sum_type = std::conditional_t<std::is_floating_point_v<T>, double,
+                     std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>>;
+
+    inline std::size_t size() const
+    { return this->_values.size(); }
+
+    inline bool empty() const
+    { return this->_values.empty(); }
+
+    inline const T *data() const
+    { return this->_values.data(); }
+
+    inline const std::vector<T> &values() const
+    { return this->_values; }
+
+    inline const T &operator[] (std::size_t row) const
+    { return this->_values[row]; }
+
+    // one bit per row, a set bit marks a NULL value
+    inline const std::vector<std::uint64_t> &null_bitmap() const
+    { return this->_nulls; }
+
+    inline bool is_null(std::size_t row) const
+    { return (this->_nulls[row / 64] >> (row % 64)) & 1; }
+
+    inline std::size_t null_count() const
+    { return this->_null_count; }
+
+    /**
+     * Amount of values which are not NULL.
+     */
+    inline std::size_t count() const
+    { return this->size() - this->_null_count; }
+
+    /**
+     * Sum of all values which are not NULL.
+     * Floating point values are summed in independent lanes, the result
+     * may differ from a sequential sum in the last bits.
+     */
+    sum_type sum() const requires std::is_arithmetic_v<T>
+    {
+        // without -ffast-math floating point additions can't be reordered,
+        // a single accumulator would keep the loops from being vectorized
+        constexpr std::size_t lanes = 8;
+        std::array<sum_type, lanes> sums{};
+        this->for_each_block([&](const T *values, std::size_t size, std::uint64_t nulls) {
+            std::size_t i = 0;
+            if (nulls == 0)
+            {
+                for (; i + lanes <= size; i += lanes)
+                    for (std::size_t lane = 0; lane < lanes; ++lane)
+                        sums[lane] += static_cast<sum_type>(values[i + lane]);
+            }
+            else
+            {
+                for (; i + lanes <= size; i += lanes)
+                    for (std::size_t lane = 0; lane < lanes; ++lane)
+                        sums[lane] += ((nulls >> (i + lane)) & 1) ? sum_type{} : static_cast<sum_type>(values[i + lane]);
+            }
+            for (; i < size; ++i)
+                sums[0] += ((nulls >> i) & 1) ? sum_type{} : static_cast<sum_type>(values[i]);
+        });
+
+        sum_type sum{};
+        for (const auto &lane : sums)
+            sum += lane;
+        return sum;
+    }
+
+    /**
+     * Smallest value which is not NULL, empty if all values are NULL.
+     * NaN values are ignored.
+     */
+    std::optional<T> min() const requires std::is_arithmetic_v<T>
+    {
+        return this->reduce(upper_bound(), [](T a, T b) { return b < a ? b : a; });
+    }
+
+    /**
+     * Largest value which is not NULL, empty if all values are NULL.
+     * NaN values are ignored.
+     */
+    std::optional<T> max() const requires std::is_arithmetic_v<T>
+    {
+        return this->reduce(lower_bound(), [](T a, T b) { return a < b ? b : a; });
+    }
+
+private:
+    friend class Database;
+    template<ColumnType...> friend class ColumnSet;
+    friend struct ColumnBufferTest; // fills buffers in the unit tests
+
+    std::vector<T> _values;
+    std::vector<std::uint64_t> _nulls;
+    std::size_t _null_count = 0;
+
+    void reserve(std::size_t rows)
+    {
+        this->_values.reserve(rows);
+        this->_nulls.reserve((rows + 63) / 64);
+    }
+
+    void push_back(std::optional<T> &&value)
+    {
+        const auto row = this->_values.size();
+        if (row % 64 == 0)
+        {
+            this->_nulls.emplace_back(0);
+        }
+
+        if (value.has_value())
+        {
+            this->_values.emplace_back(std::move(*value));
+        }
+        else
+        {
+            this->_values.emplace_back();
+            this->_nulls.back() |= std::uint64_t{1} << (row % 64);
+            ++this->_null_count;
+        }
+    }
+
+    // calls the kernel for blocks of 64 values with the matching null bitmap word,
+    // the inner loops of the kernels don't branch and can be vectorized
+    template<typename Kernel>
+    void for_each_block(Kernel &&kernel) const
+    {
+        for (std::size_t block = 0; block < this->_nulls.size(); ++block)
+        {
+            const auto offset = block * 64;
+            kernel(this->_values.data() + offset, std::min<std::size_t>(64, this->size() - offset), this->_nulls[block]);
+        }
+    }
+
+    // neutral starting values of min() and max(), infinities must be
+    // found in floating point columns which hold nothing else
+    static constexpr T upper_bound()
+    {
+        if constexpr (std::is_floating_point_v<T>)
+            return std::numeric_limits<T>::infinity();
+        else
+            return std::numeric_limits<T>::max();
+    }
+
+    static constexpr T lower_bound()
+    {
+        if constexpr (std::is_floating_point_v<T>)
+            return -std::numeric_limits<T>::infinity();
+        else
+            return std::numeric_limits<T>::lowest();
+    }
+
+    template<typename Function>
+    std::optional<T> reduce(T initial, Function &&function) const
+    {
+        if (this->count() == 0)
+        {
+            return std::nullopt;
+        }
+
+        T result = initial;
+        this->for_each_block([&](const T *values, std::size_t size, std::uint64_t nulls) {
+            for (std::size_t i = 0; i < size; ++i)
+                result = function(result, ((nulls >> i) & 1) ? initial : values[i]);
+        });
+        return result;
+    }
+};
+
+/**
+ * Result of Database::findColumns(), one buffer per selected column.
+ *
+ * Usage:
+ *   const auto result = db.findColumns<Report, std::int64_t, double>("day > 10", {"views", "score"});
+ *   const auto views = result.column<0>().sum();
+ */
+template<ColumnType... Types>
+class ColumnSet final
+{
+public:
+    template<std::size_t Index>
+    inline const auto &column() const
+    { return std::get<Index>(this->_columns); }
+
+    inline std::size_t rows() const
+    { return std::get<0>(this->_columns).size(); }
+
+private:
+    friend class Database;
+
+    std::tuple<ColumnBuffer<Types>...> _columns;
+
+    void reserve(std::size_t rows)
+    {
+        std::apply([&](auto&... columns) { (columns.reserve(rows), ...); }, this->_columns);
+    }
+
+    // the cells hold the std::optional alternative of the column types
+    void append(std::vector<utils::Value> &cells)
+    {
+        this->append(cells, std::index_sequence_for<Types...>{});
+    }
+
+    template<std::size_t... I>
+    void append(std::vector<utils::Value> &cells, std::index_sequence<I...>)
+    {
+        (std::get<I>(this->_columns).push_back(std::move(*std::get_if<std::optional<Types>>(&cells[I]))), ...);
+    }
+};
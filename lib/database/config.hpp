@@ -2,6 +2,14 @@
 
 #include <string>
 #include <cstdint>
+#include <cstddef>
+#include <chrono>
+
+enum class DatabaseBackend
+{
+    QtSql,   // QtSql with the QMYSQL driver
+    MariaDB, // MariaDB C connector, requires a build with AWESOMEDB_WITH_MARIADB
+};
 
 struct DatabaseConfig final
 {
@@ -10,4 +18,22 @@ struct DatabaseConfig final
     std::string username;
     std::string password;
     std::string database;
+
+    // reads are done by the native backend when selected, writes, streams and
+    // transactions always use QtSql
+    DatabaseBackend backend {DatabaseBackend::QtSql};
+
+    // connection pool, every thread uses its own connection
+    std::size_t pool_max_size {8}; // maximum amount of threads holding a connection at the same time
+    std::chrono::seconds pool_validation_interval {5}; // ping idle connections older than this on checkout
+    std::chrono::milliseconds pool_checkout_timeout {30000}; // wait time when all connections are in use
+    std::size_t statement_cache_size {256}; // prepared statements kept per connection, least recently used ones are closed
+
+    // executor for asynchronous queries, every worker thread holds its own pooled connection
+    std::size_t executor_threads {4}; // amount of worker threads
+    std::size_t executor_queue_depth {256}; // maximum amount of pending queries, submitting blocks when full
+
+    // write-behind buffer of Database::enableWriteBehind(), the flusher thread holds its own pooled connection
+    std::chrono::milliseconds write_behind_interval {1000}; // maximum time a buffered save stays pending
+    std::size_t write_behind_batch_size {1000}; // amount of pending saves which triggers an early flush
 };
@@ -0,0 +1,264 @@
+#include "connection_pool.hpp"
+
+#include <vector>
+#include <algorithm>
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QString>
+
+/**
+ * Per-thread list of connections. Closes all connections of the
+ * thread when it exits, as QtSql connections can't be used from
+ * any other thread.
+ */
+struct ThreadConnections final
+{
+    struct Entry
+    {
+        const ConnectionPool *pool;
+        std::weak_ptr<ConnectionPool> ref;
+        std::shared_ptr<PooledConnection> connection;
+    };
+
+    std::vector<Entry> entries;
+
+    ~ThreadConnections()
+    {
+        // releasing may destroy the last reference to a pool, which takes from the entries
+        auto entries = std::move(this->entries);
+        this->entries.clear();
+
+        for (auto&& entry : entries)
+        {
+            // connections of destroyed pools are closed when the last reference is dropped here
+            if (const auto pool = entry.ref.lock())
+            {
+                pool->release_thread(std::move(entry.connection));
+            }
+        }
+    }
+
+    PooledConnection *find(const ConnectionPool *pool)
+    {
+        for (auto it = this->entries.begin(); it != this->entries.end(); ++it)
+        {
+            if (it->pool == pool)
+            {
+                // pool was destroyed and a new one was created at the same address
+                if (it->ref.expired())
+                {
+                    this->entries.erase(it);
+                    return nullptr;
+                }
+                return it->connection.get();
+            }
+        }
+        return nullptr;
+    }
+
+    // removes the connection of the given pool from the thread
+    std::shared_ptr<PooledConnection> take(const ConnectionPool *pool)
+    {
+        const auto it = std::find_if(this->entries.begin(), this->entries.end(), [&](const Entry &entry){
+            return entry.pool == pool;
+        });
+        if (it == this->entries.end())
+        {
+            return nullptr;
+        }
+
+        auto connection = std::move(it->connection);
+        this->entries.erase(it);
+        return connection;
+    }
+};
+
+static thread_local ThreadConnections thread_connections;
+
+ConnectionPool::ConnectionPool(const DatabaseConfig &config, const std::string &name)
+    : _config(config),
+      _name(name)
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    // the connection of the destroying thread is closed right away, connections
+    // of other threads which are still alive are closed by them when they exit
+    auto own = thread_connections.take(this);
+    this->_connections.clear();
+    own.reset();
+}
+
+PooledConnection *ConnectionPool::acquire(std::string &error)
+{
+    // fast path: thread already owns a connection, no locking required
+    if (const auto connection = thread_connections.find(this))
+    {
+        if (connection->depth == 0 && !this->validate(connection))
+        {
+            error = connection->db.lastError().text().toStdString();
+            return nullptr;
+        }
+
+        ++connection->depth;
+        error.clear();
+        return connection;
+    }
+
+    // slow path: open a new connection for this thread
+    {
+        std::unique_lock lock{this->_mutex};
+        const auto max_size = std::max<std::size_t>(this->_config.pool_max_size, 1);
+
+        ++this->_waiting;
+        const auto available = this->_available.wait_for(lock, this->_config.pool_checkout_timeout, [&]{
+            return this->_connections.size() < max_size; });
+        --this->_waiting;
+
+        if (!available)
+        {
+            error = "connection pool exhausted: timed out waiting for a thread to release its connection";
+            return nullptr;
+        }
+
+        // reserve the slot while connecting without holding the lock
+        this->_connections.emplace_back(nullptr);
+    }
+
+    auto connection = this->connect(error);
+
+    const std::lock_guard lock{this->_mutex};
+    const auto slot = std::find(this->_connections.begin(), this->_connections.end(), nullptr);
+
+    if (!connection)
+    {
+        this->_connections.erase(slot);
+        this->_available.notify_one();
+        return nullptr;
+    }
+
+    const auto result = connection.get();
+    result->owner = std::this_thread::get_id();
+    result->depth = 1;
+    *slot = connection;
+
+    thread_connections.entries.emplace_back(ThreadConnections::Entry{this, this->weak_from_this(), std::move(connection)});
+
+    error.clear();
+    return result;
+}
+
+void ConnectionPool::release(PooledConnection *connection)
+{
+    if (!connection || connection->depth == 0) return;
+
+    if (--connection->depth != 0)
+    {
+        return;
+    }
+    connection->last_used = std::chrono::steady_clock::now();
+
+    // idle connections give up their slot when other threads are waiting for one
+    bool waiting;
+    {
+        const std::lock_guard lock{this->_mutex};
+        waiting = this->_waiting > 0;
+    }
+
+    if (waiting)
+    {
+        this->release_thread(thread_connections.take(this));
+    }
+}
+
+PooledConnection *ConnectionPool::current() const
+{
+    const auto connection = thread_connections.find(this);
+    return connection && connection->depth > 0 ? connection : nullptr;
+}
+
+std::shared_ptr<PooledConnection> ConnectionPool::connect(std::string &error)
+{
+    std::size_t id;
+    {
+        const std::lock_guard lock{this->_mutex};
+        id = this->_next_id++;
+    }
+
+    std::shared_ptr<PooledConnection> connection{new PooledConnection(), &ConnectionPool::disconnect};
+    connection->statements = StatementCache{this->_config.statement_cache_size};
+    connection->db = QSqlDatabase::addDatabase("QMYSQL",
+        QString::fromStdString(this->_name + "-" + std::to_string(id)));
+    connection->db.setHostName(QString::fromStdString(this->_config.host));
+    connection->db.setPort(this->_config.port);
+    connection->db.setUserName(QString::fromStdString(this->_config.username));
+    connection->db.setPassword(QString::fromStdString(this->_config.password));
+    connection->db.setDatabaseName(QString::fromStdString(this->_config.database));
+
+    if (!connection->db.open())
+    {
+        error = connection->db.lastError().text().toStdString();
+        return nullptr;
+    }
+
+    connection->last_used = std::chrono::steady_clock::now();
+    return connection;
+}
+
+bool ConnectionPool::validate(PooledConnection *connection) const
+{
+    if (!connection->db.isOpen())
+    {
+        connection->statements.clear();
+        return connection->db.open();
+    }
+
+    // recently used connections are assumed to be alive
+    if (std::chrono::steady_clock::now() - connection->last_used < this->_config.pool_validation_interval)
+    {
+        return true;
+    }
+
+    // the server may have closed the connection in the meantime (wait_timeout)
+    QSqlQuery ping(connection->db);
+    if (ping.exec("SELECT 1;"))
+    {
+        return true;
+    }
+
+    // prepared statements don't survive a reconnect
+    connection->statements.clear();
+    connection->db.close();
+    return connection->db.open();
+}
+
+void ConnectionPool::disconnect(PooledConnection *connection)
+{
+    const auto name = connection->db.connectionName();
+    connection->statements.clear();
+    connection->db.close();
+
+    // all QSqlDatabase handles must be gone before the connection can be removed
+    delete connection;
+    QSqlDatabase::removeDatabase(name);
+}
+
+void ConnectionPool::release_thread(std::shared_ptr<PooledConnection> connection)
+{
+    if (!connection) return;
+
+    {
+        const std::lock_guard lock{this->_mutex};
+        const auto it = std::find(this->_connections.begin(), this->_connections.end(), connection);
+        if (it != this->_connections.end())
+        {
+            this->_connections.erase(it);
+        }
+    }
+    this->_available.notify_one();
+
+    // drops the last reference, the connection is closed on the calling thread
+    connection.reset();
+}
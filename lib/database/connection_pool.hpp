@@ -0,0 +1,107 @@
+#pragma once
+
+#include "config.hpp"
+#include "statement_cache.hpp"
+#include "mariadb_connection.hpp"
+
+#include <string>
+#include <list>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <typeindex>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+
+#include <QSqlDatabase>
+
+// note: this header is for internal use only, it exposes QtSql
+
+/**
+ * A single open database connection owned by the connection pool.
+ * Connections are bound to the thread which created them and are
+ * never handed out to any other thread.
+ */
+struct PooledConnection final
+{
+    QSqlDatabase db;
+    std::chrono::steady_clock::time_point last_used;
+    std::thread::id owner;
+    std::size_t depth = 0; // nested checkouts on the owning thread, only touched by the owner
+    StatementCache statements; // prepared statements, invalidated on reconnect
+    std::size_t transaction_depth = 0; // nested transactions, the outermost one commits
+    bool rollback_only = false; // a nested transaction was rolled back
+    std::vector<std::pair<std::type_index, std::uint64_t>> invalidated_records; // cached records written in the transaction, id 0 stands for all records of the type
+    std::vector<std::string> invalidated_tables; // tables written in the transaction, an empty name stands for all tables
+#ifdef AWESOMEDB_WITH_MARIADB
+    std::unique_ptr<MariaDbConnection> native; // native backend connection, opened on first use
+#endif
+};
+
+/**
+ * Pool of persistent thread-affine database connections.
+ *
+ * Every thread gets its own connection which is opened lazily on the
+ * first checkout and stays open until the thread exits. Nested checkouts
+ * on the same thread share the connection. The pool size limits the amount
+ * of threads which can hold a connection at the same time, a connection
+ * is closed when its last checkout is released while other threads are
+ * waiting for a free slot. Connections are always closed on their own thread,
+ * connections of threads outliving the pool are closed when they exit.
+ */
+class ConnectionPool final : public std::enable_shared_from_this<ConnectionPool>
+{
+public:
+    ConnectionPool(const DatabaseConfig &config, const std::string &name);
+    ~ConnectionPool();
+
+    /**
+     * Checks out the connection of the calling thread. Opens a new connection
+     * when the thread has none yet and the maximum wasn't reached, otherwise
+     * waits until another thread gives up its connection.
+     * Returns nullptr and sets the error message on failure.
+     */
+    PooledConnection *acquire(std::string &error);
+
+    /**
+     * Returns a connection previously obtained with acquire() back into the pool.
+     */
+    void release(PooledConnection *connection);
+
+    /**
+     * Returns the connection currently checked out by the calling thread
+     * or nullptr if the thread doesn't hold any connection.
+     */
+    PooledConnection *current() const;
+
+private:
+    friend struct ThreadConnections;
+
+    ConnectionPool(const ConnectionPool &other) = delete;
+    ConnectionPool &operator= (const ConnectionPool &other) = delete;
+
+    const DatabaseConfig _config;
+    const std::string _name;
+
+    std::mutex _mutex;
+    std::condition_variable _available;
+    std::list<std::shared_ptr<PooledConnection>> _connections; // shared with the owning thread
+    std::size_t _next_id = 0;
+    std::size_t _waiting = 0; // threads waiting for a free slot
+
+    // open a new connection, returns nullptr on failure
+    std::shared_ptr<PooledConnection> connect(std::string &error);
+
+    // ensure the connection is still usable, reconnects if needed
+    bool validate(PooledConnection *connection) const;
+
+    // deleter of the connections, closes the connection and removes it from the Qt
+    // connection registry, runs on the thread which drops the last reference
+    static void disconnect(PooledConnection *connection);
+
+    // frees the slot of the connection, called on the owning thread
+    void release_thread(std::shared_ptr<PooledConnection> connection);
+};
@@ -0,0 +1,45 @@
+#include "coroutine.hpp"
+
+void SingleThreadScheduler::post(std::function<void()> task)
+{
+    {
+        const std::lock_guard lock{this->_mutex};
+        this->_queue.emplace_back(std::move(task));
+    }
+    this->_available.notify_one();
+}
+
+bool SingleThreadScheduler::run_one()
+{
+    std::function<void()> task;
+    {
+        std::unique_lock lock{this->_mutex};
+        this->_available.wait(lock, [&]{
+            return !this->_queue.empty() || this->_stopped; });
+
+        if (this->_stopped)
+        {
+            return false;
+        }
+
+        task = std::move(this->_queue.front());
+        this->_queue.pop_front();
+    }
+
+    task();
+    return true;
+}
+
+void SingleThreadScheduler::run()
+{
+    while (this->run_one()) {}
+}
+
+void SingleThreadScheduler::stop()
+{
+    {
+        const std::lock_guard lock{this->_mutex};
+        this->_stopped = true;
+    }
+    this->_available.notify_all();
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include "executor.hpp"
+
+#include <coroutine>
+#include <concepts>
+#include <exception>
+#include <stdexcept>
+#include <optional>
+#include <utility>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * Anything which can run a function on the thread where awaiting
+ * coroutines should be resumed, usually an event loop.
+ */
+template<typename Scheduler>
+concept DatabaseScheduler = requires(Scheduler &scheduler, std::function<void()> task) {
+    scheduler.post(std::move(task));
+};
+
+/**
+ * Awaitable database operation. The coroutine is suspended while the
+ * query runs on the executor of the database and is resumed on the
+ * given scheduler once the result is available.
+ *
+ * Suspending blocks when the executor queue is full.
+ */
+template<typename ResultType, DatabaseScheduler Scheduler>
+class DatabaseAwaitable final
+{
+public:
+    DatabaseAwaitable(DatabaseExecutor *executor, Scheduler &scheduler,
+                      std::function<DatabaseResult<ResultType>()> query)
+        : _executor(executor),
+          _scheduler(scheduler),
+          _query(std::move(query))
+    {}
+
+    constexpr bool await_ready() const noexcept
+    { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        // the awaitable lives in the suspended coroutine frame until it is resumed,
+        // exceptions are rethrown in the coroutine as nobody waits for the future
+        this->_executor->submit([this, handle]{
+            try
+            {
+                this->_result.emplace(this->_query());
+            }
+            catch (...)
+            {
+                this->_exception = std::current_exception();
+            }
+            this->_scheduler.post([handle]{ handle.resume(); });
+        });
+    }
+
+    DatabaseResult<ResultType> await_resume()
+    {
+        if (this->_exception) std::rethrow_exception(this->_exception);
+        return std::move(*this->_result);
+    }
+
+private:
+    DatabaseExecutor *_executor;
+    Scheduler &_scheduler;
+    std::function<DatabaseResult<ResultType>()> _query;
+    std::optional<DatabaseResult<ResultType>> _result;
+    std::exception_ptr _exception;
+};
+
+/**
+ * Minimal lazily started coroutine type for database operations.
+ * Tasks can be awaited from other tasks or run to completion with
+ * SingleThreadScheduler::run().
+ */
+template<typename ValueType = void>
+class DatabaseTask;
+
+namespace detail {
+
+template<typename ValueType>
+struct DatabaseTaskPromiseBase
+{
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+
+    struct FinalAwaiter
+    {
+        constexpr bool await_ready() const noexcept
+        { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            // resume the awaiting task if there is one
+            if (const auto continuation = handle.promise().continuation)
+            {
+                return continuation;
+            }
+            return std::noop_coroutine();
+        }
+
+        constexpr void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept
+    { return {}; }
+
+    FinalAwaiter final_suspend() const noexcept
+    { return {}; }
+
+    void unhandled_exception() noexcept
+    { this->exception = std::current_exception(); }
+};
+
+template<typename ValueType>
+struct DatabaseTaskPromise : DatabaseTaskPromiseBase<ValueType>
+{
+    std::optional<ValueType> value;
+
+    DatabaseTask<ValueType> get_return_object() noexcept;
+
+    template<typename T>
+    void return_value(T &&v)
+    { this->value.emplace(std::forward<T>(v)); }
+
+    ValueType result()
+    {
+        if (this->exception) std::rethrow_exception(this->exception);
+        return std::move(*this->value);
+    }
+};
+
+template<>
+struct DatabaseTaskPromise<void> : DatabaseTaskPromiseBase<void>
+{
+    DatabaseTask<void> get_return_object() noexcept;
+
+    constexpr void return_void() const noexcept {}
+
+    void result()
+    {
+        if (this->exception) std::rethrow_exception(this->exception);
+    }
+};
+
+}
+
+template<typename ValueType>
+class DatabaseTask final
+{
+public:
+    using promise_type = detail::DatabaseTaskPromise<ValueType>;
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    explicit DatabaseTask(handle_t handle)
+        : _handle(handle)
+    {}
+
+    DatabaseTask(DatabaseTask &&other) noexcept
+        : _handle(std::exchange(other._handle, nullptr))
+    {}
+
+    DatabaseTask &operator= (DatabaseTask &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (this->_handle) this->_handle.destroy();
+            this->_handle = std::exchange(other._handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~DatabaseTask()
+    {
+        if (this->_handle) this->_handle.destroy();
+    }
+
+    /**
+     * Checks if the task has finished.
+     */
+    inline bool done() const
+    { return !this->_handle || this->_handle.done(); }
+
+    /**
+     * Starts or continues the task on the current thread.
+     */
+    inline void resume() const
+    { this->_handle.resume(); }
+
+    /**
+     * Returns the result of a finished task, rethrows exceptions thrown in the task.
+     */
+    inline ValueType result() const
+    { return this->_handle.promise().result(); }
+
+    // awaiting a task starts it and resumes the awaiting coroutine when it finished
+    struct Awaiter
+    {
+        handle_t handle;
+
+        constexpr bool await_ready() const noexcept
+        { return false; }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+        {
+            this->handle.promise().continuation = continuation;
+            return this->handle;
+        }
+
+        ValueType await_resume()
+        { return this->handle.promise().result(); }
+    };
+
+    inline Awaiter operator co_await() const noexcept
+    { return Awaiter{this->_handle}; }
+
+private:
+    DatabaseTask(const DatabaseTask &other) = delete;
+    DatabaseTask &operator= (const DatabaseTask &other) = delete;
+
+    handle_t _handle;
+};
+
+namespace detail {
+
+template<typename ValueType>
+inline DatabaseTask<ValueType> DatabaseTaskPromise<ValueType>::get_return_object() noexcept
+{ return DatabaseTask<ValueType>{std::coroutine_handle<DatabaseTaskPromise<ValueType>>::from_promise(*this)}; }
+
+inline DatabaseTask<void> DatabaseTaskPromise<void>::get_return_object() noexcept
+{ return DatabaseTask<void>{std::coroutine_handle<DatabaseTaskPromise<void>>::from_promise(*this)}; }
+
+}
+
+/**
+ * Simple single-threaded event loop which resumes coroutines
+ * awaiting database operations. Posting is thread-safe, all
+ * posted functions run on the thread which calls run().
+ */
+class SingleThreadScheduler final
+{
+public:
+    SingleThreadScheduler() = default;
+
+    /**
+     * Queues a function for execution on the scheduler thread.
+     */
+    void post(std::function<void()> task);
+
+    /**
+     * Runs a single queued function, waits until one is available.
+     * Returns false when the scheduler was stopped.
+     */
+    bool run_one();
+
+    /**
+     * Processes queued functions until stop() is called.
+     */
+    void run();
+
+    /**
+     * Starts the given task and processes queued functions until it finished.
+     * Returns the result of the task. Throws std::runtime_error when the
+     * scheduler was stopped before the task finished.
+     */
+    template<typename ValueType>
+    ValueType run(DatabaseTask<ValueType> &task)
+    {
+        this->post([&task]{ task.resume(); });
+        while (!task.done() && this->run_one()) {}
+
+        if (!task.done())
+        {
+            throw std::runtime_error("scheduler was stopped before the task finished");
+        }
+        return task.result();
+    }
+
+    /**
+     * Makes run() and run_one() return, queued functions are kept.
+     */
+    void stop();
+
+private:
+    SingleThreadScheduler(const SingleThreadScheduler &other) = delete;
+    SingleThreadScheduler &operator= (const SingleThreadScheduler &other) = delete;
+
+    std::mutex _mutex;
+    std::condition_variable _available;
+    std::deque<std::function<void()>> _queue;
+    bool _stopped = false;
+};
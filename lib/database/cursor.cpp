@@ -0,0 +1,76 @@
+#include "cursor.hpp"
+#include "database.hpp"
+
+#include <QSqlQuery>
+#include <QSqlError>
+
+QueryCursor::QueryCursor(const Database *db, std::shared_ptr<QSqlQuery> query, bool projected)
+    : _db(db),
+      _query(std::move(query))
+{
+    if (this->_query)
+    {
+        this->_row = std::make_unique<Model::Query>(this->_query.get(), projected);
+    }
+}
+
+QueryCursor::QueryCursor(QueryCursor &&other) noexcept
+    : _db(std::exchange(other._db, nullptr)),
+      _query(std::move(other._query)),
+      _row(std::move(other._row))
+{
+}
+
+QueryCursor &QueryCursor::operator= (QueryCursor &&other) noexcept
+{
+    if (this != &other)
+    {
+        this->reset();
+        this->_db = std::exchange(other._db, nullptr);
+        this->_query = std::move(other._query);
+        this->_row = std::move(other._row);
+    }
+    return *this;
+}
+
+QueryCursor::~QueryCursor()
+{
+    this->reset();
+}
+
+bool QueryCursor::fetch()
+{
+    if (!this->_query)
+    {
+        return false;
+    }
+
+    if (this->_query->next())
+    {
+        return true;
+    }
+
+    // end of the result set or connection error
+    if (this->_query->lastError().isValid())
+    {
+        this->_db->error_message() = this->_query->lastError().text().toStdString();
+    }
+
+    this->reset();
+    return false;
+}
+
+void QueryCursor::reset()
+{
+    if (!this->_query)
+    {
+        return;
+    }
+
+    this->_row.reset();
+    this->_query->finish();
+    this->_query.reset();
+
+    // release the checkout of Database::internal_stream()
+    this->_db->close();
+}
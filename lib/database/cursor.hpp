@@ -0,0 +1,139 @@
+#pragma once
+
+#include "model.hpp"
+
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <iterator>
+#include <cstddef>
+
+class Database;
+class QSqlQuery;
+
+/**
+ * Forward-only result set which keeps the database connection
+ * checked out for as long as it is alive. Must be consumed on the
+ * thread which created it.
+ */
+class QueryCursor
+{
+public:
+    QueryCursor(QueryCursor &&other) noexcept;
+    QueryCursor &operator= (QueryCursor &&other) noexcept;
+    virtual ~QueryCursor();
+
+    /**
+     * Checks if the query succeeded and the cursor holds a result set.
+     * The cursor becomes invalid once all rows were consumed.
+     */
+    inline bool valid() const
+    { return this->_query != nullptr; }
+
+protected:
+    QueryCursor() = default;
+    QueryCursor(const Database *db, std::shared_ptr<QSqlQuery> query, bool projected = false);
+
+    // seek to the next row, releases the result set after the last row
+    bool fetch();
+
+    // current row for model construction
+    inline const Model::Query *row() const
+    { return this->_row.get(); }
+
+    inline const Database *database() const
+    { return this->_db; }
+
+private:
+    QueryCursor(const QueryCursor &other) = delete;
+    QueryCursor &operator= (const QueryCursor &other) = delete;
+
+    const Database *_db = nullptr;
+    std::shared_ptr<QSqlQuery> _query;
+    std::unique_ptr<Model::Query> _row;
+
+    // finish the result set and return the connection to the pool
+    void reset();
+};
+
+/**
+ * Forward-only input range over the records of a model table.
+ * Only the current model is kept in memory.
+ *
+ * Usage: for (auto&& project : db.stream<Project>("id > 10")) { ... }
+ */
+template<typename ModelType>
+class ModelCursor final : public QueryCursor
+{
+public:
+    class iterator final
+    {
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using value_type = ModelType;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(ModelCursor *cursor)
+            : _cursor(cursor)
+        {}
+
+        inline ModelType &operator* () const
+        { return *this->_cursor->_current; }
+        inline ModelType *operator-> () const
+        { return &*this->_cursor->_current; }
+
+        inline iterator &operator++ ()
+        {
+            this->_cursor->advance();
+            return *this;
+        }
+        inline void operator++ (int)
+        { ++(*this); }
+
+        inline bool operator== (std::default_sentinel_t) const
+        { return !this->_cursor || !this->_cursor->_current.has_value(); }
+
+    private:
+        ModelCursor *_cursor = nullptr;
+    };
+
+    ModelCursor() = default;
+    ModelCursor(const Database *db, std::shared_ptr<QSqlQuery> query, bool projected = false,
+                std::pmr::memory_resource *resource = nullptr)
+        : QueryCursor(db, std::move(query), projected),
+          _resource(resource)
+    {}
+
+    /**
+     * Fetches the first row on the first call. Can only be iterated once.
+     */
+    iterator begin()
+    {
+        if (!this->_started)
+        {
+            this->_started = true;
+            this->advance();
+        }
+        return iterator{this};
+    }
+
+    inline std::default_sentinel_t end() const
+    { return {}; }
+
+private:
+    std::optional<ModelType> _current;
+    std::pmr::memory_resource *_resource = nullptr; // attribute storage of the models, nullptr uses the default
+    bool _started = false;
+
+    void advance()
+    {
+        // the previous model is destroyed before the next one is built
+        this->_current.reset();
+        if (this->fetch())
+        {
+            const Model::AllocationScope scope{this->_resource};
+            this->_current.emplace(ModelType(this->row(), this->database()));
+        }
+    }
+};
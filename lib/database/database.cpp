@@ -1,9 +1,17 @@
 #include "database.hpp"
+#include "connection_pool.hpp"
+#include "statement_cache.hpp"
+#include "mariadb_connection.hpp"
 
 #include <map>
+#include <cctype>
+#include <algorithm>
 #include <array>
 #include <tuple>
 #include <sstream>
+#include <optional>
+#include <typeindex>
+#include <thread>
 
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -11,16 +19,18 @@
 #include <QVariant>
 
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 
-// workaround to avoid including QSqlDatabase in header file
-static std::map<std::uintptr_t, QSqlDatabase> dbpool;
+#include <utils/qvariant_converter.hpp>
+#include <utils/value_codec.hpp>
+#include <utils/list.hpp>
 
-#define selfptr reinterpret_cast<std::uintptr_t>(this)
-#define self dbpool[selfptr]
+// workaround to avoid including QSqlDatabase in header file
+#define self (this->connection()->db)
 
 // query wrapper
 template<typename... Args>
-static std::tuple<std::shared_ptr<QSqlQuery>, std::string> query(const Database *db, bool &error, const std::string &query, Args&&... args)
+static std::tuple<std::shared_ptr<QSqlQuery>, std::string> query(QSqlDatabase &db, bool &error, const std::string &query, Args&&... args)
 {
     QString str;
     if constexpr (sizeof...(args) == 0)
@@ -34,7 +44,7 @@ static std::tuple<std::shared_ptr<QSqlQuery>, std::string> query(const Database
 
     fmt::print("running query: {}\n", str.toStdString());
 
-    QSqlQuery q(dbpool[reinterpret_cast<std::uintptr_t>(db)]);
+    QSqlQuery q(db);
     if (!q.exec(str))
     {
         error = true;
@@ -47,50 +57,219 @@ static std::tuple<std::shared_ptr<QSqlQuery>, std::string> query(const Database
     }
 }
 
+// returns the table written by a raw SQL statement, nullopt when the statement
+// may write other or multiple tables
+static std::optional<std::string> written_table(const std::string &statement)
+{
+    // split into words, quoted identifiers and single characters,
+    // names qualified with the database name are a single token
+    std::vector<std::string> tokens;
+    const auto is_word = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+    };
+    const auto is_name = [&](char c) {
+        return c == '`' || is_word(c);
+    };
+    for (std::size_t i = 0; i < statement.size();)
+    {
+        if (std::isspace(static_cast<unsigned char>(statement[i])))
+        {
+            ++i;
+        }
+        else if (is_name(statement[i]))
+        {
+            const auto begin = i;
+            while (true)
+            {
+                if (statement[i] == '`')
+                {
+                    const auto end = statement.find('`', i + 1);
+                    if (end == std::string::npos) return std::nullopt;
+                    i = end + 1;
+                }
+                else
+                {
+                    while (i < statement.size() && is_word(statement[i])) ++i;
+                }
+
+                if (i + 1 >= statement.size() || statement[i] != '.' || !is_name(statement[i + 1])) break;
+                ++i;
+            }
+            tokens.emplace_back(statement.substr(begin, i - begin));
+        }
+        else
+        {
+            tokens.emplace_back(1, statement[i++]);
+        }
+    }
+
+    // multiple statements
+    while (!tokens.empty() && tokens.back() == ";") tokens.pop_back();
+    if (std::find(tokens.begin(), tokens.end(), ";") != tokens.end()) return std::nullopt;
+
+    // upper case token at the given position, empty past the end
+    const auto keyword = [&](std::size_t i) {
+        std::string word = i < tokens.size() ? tokens[i] : std::string{};
+        std::transform(word.begin(), word.end(), word.begin(), [](unsigned char c) { return std::toupper(c); });
+        return word;
+    };
+
+    std::size_t pos = 0;
+    const auto skip = [&](std::initializer_list<std::string_view> words) {
+        while (std::find(words.begin(), words.end(), keyword(pos)) != words.end()) ++pos;
+    };
+
+    const auto command = keyword(pos++);
+    if (command == "INSERT" || command == "REPLACE")
+    {
+        skip({"LOW_PRIORITY", "DELAYED", "HIGH_PRIORITY", "IGNORE", "INTO"});
+    }
+    else if (command == "UPDATE")
+    {
+        skip({"LOW_PRIORITY", "IGNORE"});
+        if (keyword(pos + 1) != "SET") return std::nullopt;
+    }
+    else if (command == "DELETE")
+    {
+        skip({"LOW_PRIORITY", "QUICK", "IGNORE"});
+        if (keyword(pos++) != "FROM") return std::nullopt;
+        const auto next = keyword(pos + 1);
+        if (!next.empty() && next != "WHERE" && next != "ORDER" && next != "LIMIT" && next != "RETURNING") return std::nullopt;
+    }
+    else if (command == "TRUNCATE")
+    {
+        skip({"TABLE"});
+    }
+    else if (command == "DROP" || command == "ALTER")
+    {
+        skip({"ONLINE", "IGNORE", "TEMPORARY"});
+        if (keyword(pos++) != "TABLE") return std::nullopt;
+        skip({"IF", "EXISTS"});
+        if (command == "DROP" && keyword(pos + 1) == ",") return std::nullopt;
+    }
+    else
+    {
+        return std::nullopt;
+    }
+
+    if (pos >= tokens.size() || !is_name(tokens[pos].front())) return std::nullopt;
+
+    // the last part of the name without quotes, the database name is stripped
+    const auto &name = tokens[pos];
+    std::string table;
+    for (std::size_t i = 0; i < name.size(); ++i)
+    {
+        const auto quoted = name[i] == '`';
+        const auto end = quoted ? name.find('`', i + 1) : std::min(name.find('.', i), name.size());
+        table = name.substr(i + quoted, end - i - quoted);
+        i = end + quoted;
+    }
+
+    if (table.empty()) return std::nullopt;
+    return table;
+}
+
+/**
+ * Error messages of all threads using a database.
+ */
+struct ErrorMessages final
+{
+    std::mutex mutex;
+    std::unordered_map<std::thread::id, std::string> messages;
+};
+
+/**
+ * Erases the error messages of the exiting thread from all databases it used.
+ */
+struct ThreadErrorMessages final
+{
+    std::vector<std::weak_ptr<ErrorMessages>> stores;
+
+    ~ThreadErrorMessages()
+    {
+        for (auto&& store : this->stores)
+        {
+            if (const auto errors = store.lock())
+            {
+                const std::lock_guard lock{errors->mutex};
+                errors->messages.erase(std::this_thread::get_id());
+            }
+        }
+    }
+
+    void add(const std::shared_ptr<ErrorMessages> &errors)
+    {
+        // forget destroyed databases
+        std::erase_if(this->stores, [](const auto &store){ return store.expired(); });
+        this->stores.emplace_back(errors);
+    }
+};
+
+static thread_local ThreadErrorMessages thread_error_messages;
+
 #define RETURN(value) \
-    self.close();     \
+    this->close();    \
     return value
 
 Database::Database(const DatabaseConfig &config)
-    : _config(config)
+    : _config(config),
+      _errors(std::make_shared<ErrorMessages>())
 {
-    // setup database connection
-    dbpool.insert({
-        selfptr,
-        QSqlDatabase::addDatabase("QMYSQL", QString::number(selfptr))
+    // setup connection pool, connections are opened on demand
+    this->_pool = std::make_shared<ConnectionPool>(this->_config,
+        std::to_string(reinterpret_cast<std::uintptr_t>(this)));
+
+    // worker threads are started on the first asynchronous query
+    this->_executor = std::make_unique<DatabaseExecutor>(
+        this->_config.executor_threads, this->_config.executor_queue_depth);
+
+    // the flusher thread is started on the first buffered save
+    this->_writes = std::make_unique<WriteBuffer>(
+        this->_config.write_behind_interval, this->_config.write_behind_batch_size,
+        [this](const std::vector<Model*> &models, std::string &error){
+            return this->write_buffered(models, error);
     });
-    this->dbptr = &self;
-    self.setHostName(QString::fromStdString(this->_config.host));
-    self.setPort(this->_config.port);
-    self.setUserName(QString::fromStdString(this->_config.username));
-    self.setPassword(QString::fromStdString(this->_config.password));
-    self.setDatabaseName(QString::fromStdString(this->_config.database));
+
+#ifndef AWESOMEDB_WITH_MARIADB
+    // reported through backend() and the last error message of the constructing thread
+    if (this->_config.backend == DatabaseBackend::MariaDB)
+    {
+        this->_config.backend = DatabaseBackend::QtSql;
+        this->error_message() = "native MariaDB backend not available in this build, using QtSql";
+    }
+#endif
 }
 
 Database::~Database()
 {
-    // ensure database connection is closed and remove it from the pool
-    self.close();
-    dbpool.erase(selfptr);
-    QSqlDatabase::removeDatabase(QString::number(selfptr));
-    this->dbptr = nullptr;
+    // write pending saves while the connection pool is still alive
+    this->_writes.reset();
+
+    // finish pending asynchronous queries, the workers give up their connections on exit
+    this->_executor.reset();
+
+    // closes all pooled connections and removes them from the Qt connection registry
+    this->_pool.reset();
 }
 
 bool Database::execute(const std::string &_query)
 {
-    const std::lock_guard lock{this->_mutex};
     if (!this->open()) return false;
 
     bool qerror;
-    const auto res = query(this, qerror, _query);
+    const auto res = query(self, qerror, _query);
+
+    // the statement may have modified data even when it failed, invalidating
+    // afterwards keeps concurrent finds from caching the old rows again
+    this->invalidate_table(written_table(_query).value_or(std::string{}));
     if (qerror)
     {
-        this->_lastErrorMessage = std::get<1>(res);
+        this->error_message() = std::get<1>(res);
         RETURN(false);
     }
     else
     {
-        this->_lastErrorMessage.clear();
+        this->error_message().clear();
     }
 
     RETURN(true);
@@ -98,7 +277,6 @@ bool Database::execute(const std::string &_query)
 
 const std::list<std::string> Database::tables() const
 {
-    const std::lock_guard lock{this->_mutex};
     if (!this->open()) return {};
 
     const auto qt = self.tables();
@@ -112,7 +290,6 @@ const std::list<std::string> Database::tables() const
 
 bool Database::createTable(const DatabaseTable &table, bool errorWhenExists)
 {
-    const std::lock_guard lock{this->_mutex};
     if (!this->open()) return false;
     const auto status = this->internal_create_table(table, errorWhenExists);
     RETURN(status);
@@ -120,185 +297,1418 @@ bool Database::createTable(const DatabaseTable &table, bool errorWhenExists)
 
 bool Database::dropTable(const std::string &tableName)
 {
-    return this->execute(fmt::format("DROP TABLE `{}`;", tableName));
+    // cached result sets of the table are invalidated by execute(),
+    // records are cleared after the statement so concurrent finds can't cache them again
+    const auto status = this->execute(fmt::format("DROP TABLE `{}`;", tableName));
+    this->_records.clear();
+    return status;
 }
 
 bool Database::truncateTable(const std::string &tableName)
 {
-    return this->execute(fmt::format("TRUNCATE TABLE `{}`;", tableName));
+    // the table name doesn't identify the model type,
+    // cached result sets of the table are invalidated by execute()
+    const auto status = this->execute(fmt::format("TRUNCATE TABLE `{}`;", tableName));
+    this->_records.clear();
+    return status;
 }
 
 bool Database::canConnect() const
 {
-    const std::lock_guard lock{this->_mutex};
     const auto status = this->open();
     RETURN(status);
 }
 
-bool Database::saveRecord(Model *model)
+bool Database::beginTransaction()
 {
-    const std::lock_guard lock{this->_mutex};
     if (!this->open()) return false;
-    const auto status = model->save(this);
-    RETURN(status);
+
+    const auto connection = this->connection();
+    if (connection->transaction_depth == 0)
+    {
+        fmt::print("running query: START TRANSACTION\n");
+
+        if (!connection->db.transaction())
+        {
+            this->error_message() = connection->db.lastError().text().toStdString();
+            RETURN(false);
+        }
+        connection->rollback_only = false;
+    }
+
+    // the connection stays checked out until commit or rollback
+    ++connection->transaction_depth;
+    return true;
 }
 
-bool Database::deleteRecord(Model *model)
+bool Database::commitTransaction()
 {
-    const std::lock_guard lock{this->_mutex};
-    if (!this->open()) return false;
-    const auto status = model->remove(this);
+    const auto connection = this->connection();
+    if (!connection || connection->transaction_depth == 0)
+    {
+        this->error_message() = "no active transaction";
+        return false;
+    }
+
+    bool status = true;
+    if (--connection->transaction_depth == 0)
+    {
+        if (connection->rollback_only)
+        {
+            fmt::print("running query: ROLLBACK\n");
+            connection->db.rollback();
+            this->error_message() = "transaction was rolled back by a nested transaction";
+            status = false;
+        }
+        else
+        {
+            fmt::print("running query: COMMIT\n");
+            if (!connection->db.commit())
+            {
+                this->error_message() = connection->db.lastError().text().toStdString();
+                connection->db.rollback();
+                status = false;
+            }
+        }
+        this->finish_transaction(connection);
+    }
+
+    // release the checkout of beginTransaction()
     RETURN(status);
 }
 
-bool Database::open(bool *error) const
+bool Database::rollbackTransaction()
 {
-    this->_lastErrorMessage.clear();
+    const auto connection = this->connection();
+    if (!connection || connection->transaction_depth == 0)
+    {
+        this->error_message() = "no active transaction";
+        return false;
+    }
 
-    if (self.open())
+    bool status = true;
+    if (--connection->transaction_depth == 0)
     {
-        // open success
-        this->set_error(error, false);
-        return true;
+        fmt::print("running query: ROLLBACK\n");
+        if (!connection->db.rollback())
+        {
+            this->error_message() = connection->db.lastError().text().toStdString();
+            status = false;
+        }
+        this->finish_transaction(connection);
     }
     else
     {
-        // open failed
-        this->set_error(error, true);
-        this->_lastErrorMessage = self.lastError().text().toStdString();
+        // the outermost transaction decides, but it can no longer commit
+        connection->rollback_only = true;
+    }
+
+    // release the checkout of beginTransaction()
+    RETURN(status);
+}
+
+StatementCacheStats Database::statementCacheStats() const
+{
+    return {this->_statement_hits.load(), this->_statement_misses.load()};
+}
+
+RecordCacheStats Database::recordCacheStats() const
+{
+    return this->_records.stats();
+}
+
+void Database::clearRecordCache()
+{
+    this->_records.clear();
+}
+
+QueryCacheStats Database::queryCacheStats() const
+{
+    return this->_queries.stats();
+}
+
+void Database::clearQueryCache()
+{
+    this->_queries.clear();
+}
+
+bool Database::flush()
+{
+    std::string error;
+    if (!this->_writes->flush(error))
+    {
+        this->error_message() = error;
         return false;
     }
+
+    this->error_message().clear();
+    return true;
 }
 
-void Database::close() const
+std::size_t Database::pendingWrites() const
 {
-    self.close();
+    return this->_writes->size();
 }
 
-void Database::set_error(bool *error, bool b) const
+bool Database::saveRecord(Model *model)
 {
-    if (error)
+    if (bool status; this->buffer_record(model, status))
     {
-        (*error) = b;
+        return status;
+    }
+
+    if (!this->open()) return false;
+    if (!this->write_pending({model}))
+    {
+        RETURN(false);
     }
+    const auto status = model->save(this);
+    this->invalidate_records({model});
+    RETURN(status);
 }
 
-const std::shared_ptr<Model> Database::internal_find(const Model &model, const id_t *id, const std::string *filter, const std::any &type, bool *error) const
+bool Database::upsertRecord(Model *model)
 {
-    // note: db must be open already, function does not close db after work is done
+    if (!this->write_pending({model})) return false;
+    const auto status = this->internal_upsert_records({model});
+    this->invalidate_records({model});
+    return status;
+}
 
-    const std::lock_guard lock{this->_mutex};
+// returns the end of the chunk starting at begin which stays below the statement limits
+template<typename RowSize>
+static std::vector<Model*>::const_iterator next_chunk(
+    std::vector<Model*>::const_iterator begin, std::vector<Model*>::const_iterator end,
+    std::size_t placeholders_per_row, std::uint64_t max_packet_size, const RowSize &row_size)
+{
+    // MariaDB supports up to 65535 placeholders per statement
+    const std::size_t max_rows = std::max<std::size_t>(65535 / std::max<std::size_t>(placeholders_per_row, 1), 1);
+    const std::uint64_t packet_budget = max_packet_size - max_packet_size / 10;
 
-    std::string statement;
-    if (id)
+    auto it = begin;
+    std::uint64_t packet_size = 1024;
+    while (it != end && static_cast<std::size_t>(it - begin) < max_rows)
     {
-        statement = fmt::format("SELECT * FROM `{}` WHERE id={};", model.table_name(), *id);
+        const auto size = row_size(*it);
+
+        // a single row must always be sent, even when it is too large
+        if (it != begin && packet_size + size > packet_budget)
+        {
+            break;
+        }
+
+        packet_size += size;
+        ++it;
     }
-    else
+    return it;
+}
+
+// rough size of a bound value in the statement packet
+static std::size_t estimate_value_size(const utils::Value &value)
+{
+    if (const auto str = std::get_if<std::string>(&value))
+    {
+        return str->size() + 9;
+    }
+    if (const auto str = std::get_if<std::optional<std::string>>(&value))
+    {
+        return str->has_value() ? str->value().size() + 9 : 1;
+    }
+    return 9;
+}
+
+std::size_t Database::estimate_row_size(const Model *model, const std::vector<std::size_t> &slots)
+{
+    std::size_t size = 0;
+    for (auto&& slot : slots)
+    {
+        size += estimate_value_size(model->attribute(slot));
+    }
+    return size;
+}
+
+bool Database::validate_records(const std::vector<Model*> &models) const
+{
+    for (auto&& model : models)
     {
-        statement = fmt::format("SELECT * FROM `{}` WHERE {} LIMIT 1;", model.table_name(), *filter);
+        std::string error_message;
+        if (!model->is_valid(&error_message))
+        {
+            this->error_message() = error_message;
+            return false;
+        }
+
+        if (!model->has_model_attributes())
+        {
+            this->error_message() = "model is empty, please add some attributes first";
+            return false;
+        }
     }
+    return true;
+}
+
+void Database::query_batch_limits(std::uint64_t &max_packet_size, std::uint64_t &id_increment, bool &consecutive_ids) const
+{
+    // note: db must be open already, function does not close db after work is done
+
+    max_packet_size = 4 * 1024 * 1024;
+    id_increment = 1;
+    consecutive_ids = false;
 
     bool e;
-    const auto res = query(this, e, statement);
-    if (e)
+    const auto res = query(self, e, "SELECT @@max_allowed_packet, @@auto_increment_increment, @@innodb_autoinc_lock_mode;");
+    if (!e && std::get<0>(res)->next())
     {
-        this->set_error(error, true);
-        this->_lastErrorMessage = std::get<1>(res);
-        return nullptr;
+        max_packet_size = std::get<0>(res)->value(0).toULongLong();
+        id_increment = std::max<std::uint64_t>(std::get<0>(res)->value(1).toULongLong(), 1);
+
+        // the interleaved lock mode 2 doesn't guarantee consecutive ids within a multi-row insert
+        consecutive_ids = std::get<0>(res)->value(2).toULongLong() < 2;
     }
+}
 
-    // try to seek to first result
-    if (!std::get<0>(res)->next())
+bool Database::internal_save_records(const std::vector<Model*> &models)
+{
+    if (!this->open()) return false;
+
+    // validate all models before writing anything
+    if (!this->validate_records(models))
     {
-        this->set_error(error, true);
-        this->_lastErrorMessage = fmt::format("empty result set for {}", model.table_name());
-        return nullptr;
+        RETURN(false);
     }
 
-    this->set_error(error, false);
+    // group new records by model type and existing records by model type and
+    // changed columns in order of appearance, unchanged records are skipped
+    std::vector<std::pair<std::type_index, std::vector<Model*>>> new_records;
+    std::vector<std::tuple<std::type_index, std::list<std::string>, std::vector<Model*>>> existing_records;
+    for (auto&& model : models)
+    {
+        const auto type = std::type_index(typeid(*model));
+
+        if (model->is_new_record())
+        {
+            if (!model->check_fully_loaded(this))
+            {
+                RETURN(false);
+            }
+
+            auto it = std::find_if(new_records.begin(), new_records.end(), [&](const auto &group){
+                return group.first == type;
+            });
+            if (it == new_records.end())
+            {
+                it = new_records.insert(new_records.end(), {type, {}});
+            }
+            it->second.emplace_back(model);
+        }
+        else
+        {
+            const auto columns = model->changed_columns();
+            if (columns.empty())
+            {
+                continue;
+            }
+
+            auto it = std::find_if(existing_records.begin(), existing_records.end(), [&](const auto &group){
+                return std::get<0>(group) == type && std::get<1>(group) == columns;
+            });
+            if (it == existing_records.end())
+            {
+                it = existing_records.insert(existing_records.end(), {type, columns, {}});
+            }
+            std::get<2>(*it).emplace_back(model);
+        }
+    }
+
+    if (new_records.empty() && existing_records.empty())
+    {
+        RETURN(true);
+    }
 
-    // look if current model is registered in the registrar and call the constructor
-    if (const auto it = DatabaseRegistrar::model_registrar.find(std::type_index(type.type()));
-        it != DatabaseRegistrar::model_registrar.cend())
+    // server limits for chunking and id assignment
+    std::uint64_t max_packet_size, id_increment;
+    bool consecutive_ids;
+    this->query_batch_limits(max_packet_size, id_increment, consecutive_ids);
+
+    for (auto&& group : new_records)
+    {
+        if (!this->internal_insert_records(group.second, max_packet_size, id_increment, consecutive_ids))
+        {
+            RETURN(false);
+        }
+    }
+
+    for (auto&& group : existing_records)
     {
-        const auto q = Model::Query(std::get<0>(res).get());
-        return it->second(&q, this);
+        if (!this->internal_update_records(std::get<2>(group), std::get<1>(group), max_packet_size))
+        {
+            RETURN(false);
+        }
     }
 
-    // model not registered
-    this->set_error(error, true);
-    this->_lastErrorMessage = fmt::format("unsupported model type: {}", model.type_name());
-    return nullptr;
+    RETURN(true);
 }
 
-const std::list<std::shared_ptr<Model>> Database::internal_find_all(const Model &model, const std::string *filter, const std::any &type, bool *error) const
+bool Database::internal_insert_records(const std::vector<Model*> &models, std::uint64_t max_packet_size, std::uint64_t id_increment, bool consecutive_ids)
 {
     // note: db must be open already, function does not close db after work is done
 
-    const std::lock_guard lock{this->_mutex};
+    // all models of the group share the same schema
+    const auto slots = models.front()->attribute_slots(models.front()->attribute_columns());
 
-    std::string statement;
-    if (filter)
+    auto begin = models.cbegin();
+    while (begin != models.cend())
     {
-        statement = fmt::format("SELECT * FROM `{}` WHERE {};", model.table_name(), *filter);
+        // without consecutive ids every row needs its own statement to obtain its id
+        const auto end = !consecutive_ids ? std::next(begin) :
+            next_chunk(begin, models.cend(), slots.size(), max_packet_size,
+                [&](const Model *model){ return estimate_row_size(model, slots); });
+        const auto rows = static_cast<std::size_t>(end - begin);
+
+        QSqlQuery q(self);
+        if (!q.prepare(QString::fromStdString(models.front()->generate_batch_insert_query(rows))))
+        {
+            this->error_message() = q.lastError().text().toStdString();
+            return false;
+        }
+
+        for (auto it = begin; it != end; ++it)
+        {
+            for (auto&& slot : slots)
+            {
+                q.addBindValue((*it)->attribute_qvariant(slot));
+            }
+        }
+
+        fmt::print("running prepared batch insert: {} rows into {}\n", rows, models.front()->table_name());
+
+        if (!q.exec())
+        {
+            this->error_message() = q.lastError().text().toStdString();
+            return false;
+        }
+
+        // the last insert id of a multi-row insert is the id of the first row
+        const id_t first_id = q.lastInsertId().toULongLong();
+        if (first_id != 0)
+        {
+            id_t id = first_id;
+            for (auto it = begin; it != end; ++it, id += id_increment)
+            {
+                (*it)->set_id(id);
+            }
+        }
+
+        begin = end;
     }
-    else
+
+    this->error_message().clear();
+    return true;
+}
+
+bool Database::internal_update_records(const std::vector<Model*> &models, const std::list<std::string> &columns, std::uint64_t max_packet_size)
+{
+    // note: db must be open already, function does not close db after work is done
+
+    // every changed value is bound together with the id of its row, plus the ids for the IN list
+    const auto placeholders_per_row = columns.size() * 2 + 1;
+    const auto slots = models.front()->attribute_slots(columns);
+
+    auto begin = models.cbegin();
+    while (begin != models.cend())
     {
-        statement = fmt::format("SELECT * FROM `{}`;", model.table_name());
+        const auto end = next_chunk(begin, models.cend(), placeholders_per_row, max_packet_size,
+            [&](const Model *model){ return estimate_row_size(model, slots) + slots.size() * 9 + 9; });
+        const auto rows = static_cast<std::size_t>(end - begin);
+
+        QSqlQuery q(self);
+        if (!q.prepare(QString::fromStdString(models.front()->generate_batch_update_query(columns, rows))))
+        {
+            this->error_message() = q.lastError().text().toStdString();
+            return false;
+        }
+
+        for (auto&& slot : slots)
+        {
+            for (auto it = begin; it != end; ++it)
+            {
+                q.addBindValue(QVariant::fromValue((*it)->id()));
+                q.addBindValue((*it)->attribute_qvariant(slot));
+            }
+        }
+        for (auto it = begin; it != end; ++it)
+        {
+            q.addBindValue(QVariant::fromValue((*it)->id()));
+        }
+
+        fmt::print("running prepared batch update: {} rows in {}\n", rows, models.front()->table_name());
+
+        if (!q.exec())
+        {
+            this->error_message() = q.lastError().text().toStdString();
+            return false;
+        }
+
+        begin = end;
     }
 
-    bool e;
-    const auto res = query(this, e, statement);
-    if (e)
+    this->error_message().clear();
+    return true;
+}
+
+bool Database::internal_upsert_records(const std::vector<Model*> &models)
+{
+    if (!this->open()) return false;
+
+    if (!this->validate_records(models))
     {
-        this->set_error(error, true);
-        this->_lastErrorMessage = std::get<1>(res);
-        return {};
+        RETURN(false);
     }
 
-    this->set_error(error, false);
-
-    std::list<std::shared_ptr<Model>> results;
-    while (std::get<0>(res)->next())
+    // group records by model type, changed columns and presence of the id
+    std::vector<std::tuple<std::type_index, std::list<std::string>, bool, std::vector<Model*>>> groups;
+    for (auto&& model : models)
     {
-        // look if current model is registered in the registrar and call the constructor
-        if (const auto it = DatabaseRegistrar::model_registrar.find(std::type_index(type.type()));
-            it != DatabaseRegistrar::model_registrar.cend())
+        // upserts write all columns
+        if (!model->check_fully_loaded(this))
         {
-            const auto q = Model::Query(std::get<0>(res).get());
-            results.emplace_back(it->second(&q, this));
+            RETURN(false);
         }
-        // if model isn't registered, cancel iteration and return empty list
-        else
+
+        const auto type = std::type_index(typeid(*model));
+        const auto columns = model->changed_columns();
+        const bool with_id = !model->is_new_record();
+
+        auto it = std::find_if(groups.begin(), groups.end(), [&](const auto &group){
+            return std::get<0>(group) == type && std::get<1>(group) == columns && std::get<2>(group) == with_id;
+        });
+        if (it == groups.end())
         {
-            this->set_error(error, true);
-            this->_lastErrorMessage = fmt::format("unsupported model type: {}", model.type_name());
-            return {};
+            it = groups.insert(groups.end(), {type, columns, with_id, {}});
         }
+        std::get<3>(*it).emplace_back(model);
     }
 
-    return results;
+    // limits are only needed for multi-row statements
+    std::uint64_t max_packet_size = 0, id_increment = 1;
+    bool consecutive_ids = false;
+    if (models.size() > 1)
+    {
+        this->query_batch_limits(max_packet_size, id_increment, consecutive_ids);
+    }
+
+    for (auto&& group : groups)
+    {
+        if (!this->internal_upsert_group(std::get<3>(group), std::get<1>(group), std::get<2>(group), max_packet_size))
+        {
+            RETURN(false);
+        }
+    }
+
+    RETURN(true);
+}
+
+bool Database::internal_upsert_group(const std::vector<Model*> &models, const std::list<std::string> &changed_columns, bool with_id, std::uint64_t max_packet_size)
+{
+    // note: db must be open already, function does not close db after work is done
+
+    // the id is the first slot
+    auto slots = models.front()->attribute_slots(models.front()->attribute_columns());
+    if (with_id)
+    {
+        slots.insert(slots.begin(), Model::id_slot);
+    }
+
+    auto begin = models.cbegin();
+    while (begin != models.cend())
+    {
+        // records without id need their own statement to obtain the id of the affected row
+        const auto end = !with_id || max_packet_size == 0 ? std::next(begin) :
+            next_chunk(begin, models.cend(), slots.size(), max_packet_size,
+                [&](const Model *model){ return estimate_row_size(model, slots); });
+        const auto rows = static_cast<std::size_t>(end - begin);
+
+        std::shared_ptr<QSqlQuery> q;
+        if (rows == 1)
+        {
+            auto key = utils::list_join(changed_columns, ",");
+            key += with_id ? "|id" : "";
+            q = this->prepared({std::type_index(typeid(*models.front())), StatementKind::Upsert, key}, [&]{
+                return models.front()->generate_upsert_query(changed_columns, with_id, 1);
+            });
+            if (!q)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            q = std::make_shared<QSqlQuery>(self);
+            if (!q->prepare(QString::fromStdString(models.front()->generate_upsert_query(changed_columns, with_id, rows))))
+            {
+                this->error_message() = q->lastError().text().toStdString();
+                return false;
+            }
+        }
+
+        for (auto it = begin; it != end; ++it)
+        {
+            for (auto&& slot : slots)
+            {
+                q->addBindValue((*it)->attribute_qvariant(slot));
+            }
+        }
+
+        fmt::print("running prepared upsert: {} rows into {}\n", rows, models.front()->table_name());
+
+        if (!q->exec())
+        {
+            this->error_message() = q->lastError().text().toStdString();
+            return false;
+        }
+
+        // id of the inserted or updated row, see generate_upsert_query()
+        if (!with_id)
+        {
+            const id_t id = q->lastInsertId().toULongLong();
+            if (id != 0)
+            {
+                (*begin)->set_id(id);
+            }
+        }
+
+        begin = end;
+    }
+
+    this->error_message().clear();
+    return true;
+}
+
+bool Database::deleteRecord(Model *model)
+{
+    if (!this->open()) return false;
+
+    // pending saves of the deleted record are dropped, inside a transaction they are
+    // written before as the delete may be rolled back
+    std::vector<std::unique_ptr<Model>> pending;
+    if (const auto connection = this->connection(); connection && connection->transaction_depth > 0)
+    {
+        if (!this->write_pending({model}))
+        {
+            RETURN(false);
+        }
+    }
+    else
+    {
+        pending = this->_writes->take({model});
+    }
+
+    // remove() resets the id
+    const auto id = model->id();
+    const auto status = model->remove(this);
+    if (!status)
+    {
+        this->_writes->restore(std::move(pending));
+    }
+    if (id != 0)
+    {
+        this->invalidate_record(typeid(*model), id);
+    }
+    this->invalidate_table(model->table_name());
+    RETURN(status);
+}
+
+std::future<DatabaseResult<bool>> Database::saveRecordAsync(Model *model)
+{
+    return this->async<bool>([this, model](bool *error){
+        const auto status = this->saveRecord(model);
+        this->set_error(error, !status);
+        return status;
+    });
+}
+
+std::future<DatabaseResult<bool>> Database::deleteRecordAsync(Model *model)
+{
+    return this->async<bool>([this, model](bool *error){
+        const auto status = this->deleteRecord(model);
+        this->set_error(error, !status);
+        return status;
+    });
+}
+
+std::uint64_t Database::internal_delete_ids(const std::string &table, const std::vector<id_t> &ids, bool *error)
+{
+    if (!this->open(error)) return 0;
+
+    // ids are integers, formatting them into the statement is safe
+    static constexpr std::size_t chunk_size = 10000;
+
+    std::uint64_t deleted = 0;
+    for (std::size_t offset = 0; offset < ids.size(); offset += chunk_size)
+    {
+        const auto begin = ids.begin() + offset;
+        const auto end = ids.begin() + std::min(offset + chunk_size, ids.size());
+
+        bool e;
+        const auto res = query(self, e, fmt::format("DELETE FROM `{}` WHERE id IN ({});",
+            table, fmt::join(begin, end, ",")));
+        if (e)
+        {
+            this->set_error(error, true);
+            this->error_message() = std::get<1>(res);
+            RETURN(deleted);
+        }
+
+        deleted += std::max(std::get<0>(res)->numRowsAffected(), 0);
+    }
+
+    this->set_error(error, false);
+    RETURN(deleted);
+}
+
+std::uint64_t Database::internal_delete_where(const std::string &table, const std::string &filter, std::uint64_t batch_size, bool *error)
+{
+    if (!this->open(error)) return 0;
+
+    const auto statement = batch_size == 0 ?
+        fmt::format("DELETE FROM `{}` WHERE {};", table, filter) :
+        fmt::format("DELETE FROM `{}` WHERE {} LIMIT {};", table, filter, batch_size);
+
+    std::uint64_t deleted = 0;
+    while (true)
+    {
+        bool e;
+        const auto res = query(self, e, statement);
+        if (e)
+        {
+            this->set_error(error, true);
+            this->error_message() = std::get<1>(res);
+            RETURN(deleted);
+        }
+
+        const std::uint64_t affected = std::max(std::get<0>(res)->numRowsAffected(), 0);
+        deleted += affected;
+
+        // a partial batch means there is nothing left to delete
+        if (batch_size == 0 || affected < batch_size)
+        {
+            break;
+        }
+    }
+
+    this->set_error(error, false);
+    RETURN(deleted);
+}
+
+bool Database::open(bool *error) const
+{
+    if (this->_pool->acquire(this->error_message()))
+    {
+        // open success
+        this->set_error(error, false);
+        return true;
+    }
+    else
+    {
+        // open failed, error message was set by the pool
+        this->set_error(error, true);
+        return false;
+    }
+}
+
+void Database::close() const
+{
+    // return the connection to the pool, it stays open for reuse
+    this->_pool->release(this->connection());
+}
+
+PooledConnection *Database::connection() const
+{
+    return this->_pool->current();
+}
+
+std::string &Database::error_message() const
+{
+    // std::unordered_map never invalidates references to its elements
+    const std::lock_guard lock{this->_errors->mutex};
+    const auto [it, inserted] = this->_errors->messages.try_emplace(std::this_thread::get_id());
+    if (inserted)
+    {
+        thread_error_messages.add(this->_errors);
+    }
+    return it->second;
+}
+
+std::shared_ptr<QSqlQuery> Database::prepared(const StatementKey &key, const std::function<std::string()> &generate) const
+{
+    auto &statements = this->connection()->statements;
+
+    // statements still referenced by an outer operation on this thread are busy
+    const auto cached = statements.find(key);
+    if (cached && cached->use_count() == 1)
+    {
+        ++this->_statement_hits;
+        return *cached;
+    }
+
+    ++this->_statement_misses;
+
+    auto statement = std::make_shared<QSqlQuery>(self);
+    if (!statement->prepare(QString::fromStdString(generate())))
+    {
+        this->error_message() = statement->lastError().text().toStdString();
+        return nullptr;
+    }
+
+    if (!cached)
+    {
+        statements.insert(key, statement);
+    }
+    return statement;
+}
+
+#ifdef AWESOMEDB_WITH_MARIADB
+MariaDbConnection *Database::native_connection() const
+{
+    const auto connection = this->connection();
+    if (this->_config.backend != DatabaseBackend::MariaDB || connection->transaction_depth > 0)
+    {
+        return nullptr;
+    }
+
+    if (!connection->native)
+    {
+        connection->native = std::make_unique<MariaDbConnection>(this->_config);
+    }
+    return connection->native.get();
+}
+
+bool Database::internal_select_native(MariaDbConnection *native, const std::string &statement, const id_t *id, bool projected, const RowSink &sink, bool *error) const
+{
+    // note: db must be open already, function does not close db after work is done
+
+    std::string e;
+    const auto result = native->select(statement, id, id != nullptr, e);
+    if (!result)
+    {
+        this->set_error(error, true);
+        this->error_message() = e;
+        return false;
+    }
+
+    sink.reserve(result->size());
+
+    // column ordinals are resolved on the first row and shared by all rows
+    const auto q = Model::Query(result.get(), projected);
+    while (result->next())
+    {
+        sink.emplace(&q);
+    }
+
+    if (!result->error().empty())
+    {
+        this->set_error(error, true);
+        this->error_message() = result->error();
+        return false;
+    }
+
+    this->set_error(error, false);
+    return true;
+}
+#endif
+
+std::shared_ptr<const Model> Database::cached_record(const std::type_index &type, id_t id, std::uint64_t &token) const
+{
+    // the transaction may have changed the record, reads must see its own writes and snapshot
+    if (const auto connection = this->connection(); connection && connection->transaction_depth > 0)
+    {
+        token = 0;
+        return nullptr;
+    }
+
+    return this->_records.find(type, id, token);
+}
+
+void Database::cache_record(const Model &model, std::uint64_t token) const
+{
+    // records read inside a transaction may not be committed yet
+    if (const auto connection = this->connection(); connection && connection->transaction_depth > 0)
+    {
+        return;
+    }
+
+    this->_records.insert(typeid(model), model.id(), model, token);
+}
+
+void Database::invalidate_record(const std::type_index &type, id_t id) const
+{
+    if (!this->_records.active())
+    {
+        return;
+    }
+
+    if (id == 0)
+    {
+        this->_records.erase(type);
+    }
+    else
+    {
+        this->_records.erase(type, id);
+    }
+
+    // other threads can still read and cache the old record until the transaction ends
+    if (const auto connection = this->connection(); connection && connection->transaction_depth > 0)
+    {
+        connection->invalidated_records.emplace_back(type, id);
+    }
+}
+
+void Database::invalidate_records(const std::vector<Model*> &models) const
+{
+    std::vector<std::string> tables;
+    for (auto&& model : models)
+    {
+        // new records which failed to save have no id
+        if (model->id() != 0)
+        {
+            this->invalidate_record(typeid(*model), model->id());
+        }
+
+        // batches which failed may have written some of their chunks
+        if (auto table = model->table_name(); std::find(tables.begin(), tables.end(), table) == tables.end())
+        {
+            tables.emplace_back(std::move(table));
+        }
+    }
+
+    for (auto&& table : tables)
+    {
+        this->invalidate_table(table);
+    }
+}
+
+void Database::finish_transaction(PooledConnection *connection) const
+{
+    for (auto&& [type, id] : connection->invalidated_records)
+    {
+        if (id == 0)
+        {
+            this->_records.erase(type);
+        }
+        else
+        {
+            this->_records.erase(type, id);
+        }
+    }
+    connection->invalidated_records.clear();
+
+    for (auto&& table : connection->invalidated_tables)
+    {
+        if (table.empty())
+        {
+            this->_queries.invalidate();
+        }
+        else
+        {
+            this->_queries.invalidate(table);
+        }
+    }
+    connection->invalidated_tables.clear();
+}
+
+std::shared_ptr<const void> Database::cached_query(const std::type_index &type, const std::string &table, const std::string &filter, std::uint64_t &generation) const
+{
+    // result sets read inside a transaction may contain uncommitted writes
+    if (const auto connection = this->connection(); connection && connection->transaction_depth > 0)
+    {
+        generation = 0;
+        return nullptr;
+    }
+
+    return this->_queries.find(type, table, filter, generation);
+}
+
+void Database::cache_query(const std::type_index &type, const std::string &table, const std::string &filter, std::shared_ptr<const void> result, std::uint64_t generation) const
+{
+    if (const auto connection = this->connection(); connection && connection->transaction_depth > 0)
+    {
+        return;
+    }
+
+    this->_queries.insert(type, table, filter, std::move(result), generation);
+}
+
+void Database::invalidate_table(const std::string &table) const
+{
+    if (!this->_queries.active())
+    {
+        return;
+    }
+
+    if (table.empty())
+    {
+        this->_queries.invalidate();
+    }
+    else
+    {
+        this->_queries.invalidate(table);
+    }
+
+    // other threads can still read and cache the old result sets until the transaction ends
+    if (const auto connection = this->connection(); connection && connection->transaction_depth > 0)
+    {
+        if (std::find(connection->invalidated_tables.begin(), connection->invalidated_tables.end(), table) == connection->invalidated_tables.end())
+        {
+            connection->invalidated_tables.emplace_back(table);
+        }
+    }
+}
+
+bool Database::buffer_record(Model *model, bool &status)
+{
+    if (!this->_writes->active() || model->is_new_record() || !model->has_changes())
+    {
+        return false;
+    }
+
+    // transactions expect their writes to happen inside of them
+    if (const auto connection = this->connection(); connection && connection->transaction_depth > 0)
+    {
+        return false;
+    }
+
+    // invalid models must fail right away, the flusher can't report errors to the caller
+    std::string error_message;
+    if (!model->is_valid(&error_message))
+    {
+        this->error_message() = error_message;
+        status = false;
+        return true;
+    }
+
+    if (!this->_writes->add(*model))
+    {
+        return false;
+    }
+
+    this->error_message().clear();
+    status = true;
+    return true;
+}
+
+bool Database::write_pending(const std::vector<Model*> &models)
+{
+    auto pending = this->_writes->take(models);
+    if (pending.empty())
+    {
+        return true;
+    }
+
+    std::vector<Model*> pointers;
+    pointers.reserve(pending.size());
+    for (auto&& model : pending)
+    {
+        pointers.emplace_back(model.get());
+    }
+
+    std::string error;
+    bool status = false;
+    if (const auto connection = this->connection(); connection && connection->transaction_depth > 0)
+    {
+        // the saves were already acknowledged, writing them on the connection of the
+        // transaction would lose them on a rollback. a thread of its own writes them
+        // with its own pooled connection, waiting for the flusher could deadlock on
+        // rows locked by the transaction
+        std::thread writer([&]{ status = this->write_buffered(pointers, error); });
+        writer.join();
+        if (!status)
+        {
+            this->error_message() = error;
+        }
+    }
+    else
+    {
+        status = this->write_buffered(pointers, error);
+    }
+
+    if (!status)
+    {
+        this->_writes->restore(std::move(pending));
+        return false;
+    }
+    return true;
+}
+
+bool Database::write_buffered(const std::vector<Model*> &models, std::string &error)
+{
+    // runs on the flusher thread or on the thread calling flush()
+    const auto status = this->internal_save_records(models);
+    if (!status)
+    {
+        error = this->error_message();
+    }
+    this->invalidate_records(models);
+    return status;
+}
+
+void Database::set_error(bool *error, bool b) const
+{
+    if (error)
+    {
+        (*error) = b;
+    }
+}
+
+// builds the select list of a query, the id is always selected
+static bool select_list(const Model &model, const std::list<std::string> *columns, std::string &select, std::string &error)
+{
+    if (!columns)
+    {
+        select = "*";
+        return true;
+    }
+
+    std::list<std::string> selected{"id"};
+    for (auto&& column : *columns)
+    {
+        if (!model.model_schema().contains(column))
+        {
+            error = fmt::format("{} has no column {}", model.type_name(), column);
+            return false;
+        }
+        if (column != "id")
+        {
+            selected.emplace_back(column);
+        }
+    }
+
+    select = utils::list_join(selected, ",");
+    return true;
+}
+
+// only registered models are constructed by the find functions
+static bool is_registered(const Model &model, const std::any &type, std::string &error)
+{
+    if (DatabaseRegistrar::model_registrar.find(std::type_index(type.type())) == DatabaseRegistrar::model_registrar.cend())
+    {
+        error = fmt::format("unsupported model type: {}", model.type_name());
+        return false;
+    }
+    return true;
+}
+
+bool Database::internal_find(const Model &model, const id_t *id, const std::string *filter, const std::list<std::string> *columns, const std::any &type, const RowSink &sink, bool *error) const
+{
+    // note: db must be open already, function does not close db after work is done
+
+    std::string select;
+    if (std::string e; !is_registered(model, type, e) || !select_list(model, columns, select, e))
+    {
+        this->set_error(error, true);
+        this->error_message() = e;
+        return false;
+    }
+
+#ifdef AWESOMEDB_WITH_MARIADB
+    if (const auto native = this->native_connection())
+    {
+        const auto statement = !id ? fmt::format("SELECT {} FROM `{}` WHERE {} LIMIT 1;", select, model.table_name(), *filter) :
+            columns ? fmt::format("SELECT {} FROM `{}` WHERE id=:id;", select, model.table_name()) :
+            model.model_schema().find_statement();
+
+        bool found = false;
+        if (!this->internal_select_native(native, statement, id, columns != nullptr, {
+                [](std::size_t) {},
+                [&](const Model::Query *query) { sink.emplace(query); found = true; }
+            }, error))
+        {
+            return false;
+        }
+        if (!found)
+        {
+            this->set_error(error, true);
+            this->error_message() = fmt::format("empty result set for {}", model.table_name());
+            return false;
+        }
+        return true;
+    }
+#endif
+
+    std::shared_ptr<QSqlQuery> statement;
+    if (id)
+    {
+        // statements are cached per projection
+        statement = this->prepared({std::type_index(typeid(model)), StatementKind::FindById, columns ? select : std::string{}}, [&]{
+            return columns ? fmt::format("SELECT {} FROM `{}` WHERE id=:id;", select, model.table_name()) :
+                model.model_schema().find_statement();
+        });
+        if (!statement)
+        {
+            this->set_error(error, true);
+            return false;
+        }
+
+        statement->bindValue(":id", QVariant::fromValue(*id));
+        fmt::print("running prepared query: {} [id={}]\n", statement->lastQuery().toStdString(), *id);
+        if (!statement->exec())
+        {
+            this->set_error(error, true);
+            this->error_message() = statement->lastError().text().toStdString();
+            return false;
+        }
+    }
+    else
+    {
+        bool e;
+        const auto res = query(self, e, fmt::format("SELECT {} FROM `{}` WHERE {} LIMIT 1;", select, model.table_name(), *filter));
+        if (e)
+        {
+            this->set_error(error, true);
+            this->error_message() = std::get<1>(res);
+            return false;
+        }
+        statement = std::get<0>(res);
+    }
+
+    // try to seek to first result
+    if (!statement->next())
+    {
+        statement->finish();
+        this->set_error(error, true);
+        this->error_message() = fmt::format("empty result set for {}", model.table_name());
+        return false;
+    }
+
+    this->set_error(error, false);
+
+    const auto q = Model::Query(statement.get(), columns != nullptr);
+    sink.emplace(&q);
+
+    // release the result set, the statement may be cached for reuse
+    statement->finish();
+    return true;
+}
+
+bool Database::internal_find_all(const Model &model, const std::string *filter, const std::list<std::string> *columns, const std::any &type, const RowSink &sink, bool *error) const
+{
+    // note: db must be open already, function does not close db after work is done
+
+    std::string select;
+    if (std::string e; !is_registered(model, type, e) || !select_list(model, columns, select, e))
+    {
+        this->set_error(error, true);
+        this->error_message() = e;
+        return false;
+    }
+
+    std::string statement;
+    if (filter)
+    {
+        statement = fmt::format("SELECT {} FROM `{}` WHERE {};", select, model.table_name(), *filter);
+    }
+    else
+    {
+        statement = fmt::format("SELECT {} FROM `{}`;", select, model.table_name());
+    }
+
+#ifdef AWESOMEDB_WITH_MARIADB
+    if (const auto native = this->native_connection())
+    {
+        return this->internal_select_native(native, statement, nullptr, columns != nullptr, sink, error);
+    }
+#endif
+
+    bool e;
+    const auto res = query(self, e, statement);
+    if (e)
+    {
+        this->set_error(error, true);
+        this->error_message() = std::get<1>(res);
+        return false;
+    }
+
+    this->set_error(error, false);
+
+    // the MySQL driver buffers the result set, the size is known upfront
+    if (const auto size = std::get<0>(res)->size(); size > 0)
+    {
+        sink.reserve(static_cast<std::size_t>(size));
+    }
+
+    // column ordinals are resolved on the first row and shared by all rows
+    const auto q = Model::Query(std::get<0>(res).get(), columns != nullptr);
+    while (std::get<0>(res)->next())
+    {
+        sink.emplace(&q);
+    }
+
+    return true;
+}
+
+bool Database::internal_find_columns(const Model &model, const std::string *filter, const std::vector<std::string> &columns, std::vector<utils::Value> &cells,
+                                     const std::function<void(std::size_t rows)> &reserve, const std::function<void(std::vector<utils::Value> &cells)> &append, bool *error) const
+{
+    // note: db must be open already, function does not close db after work is done
+
+    for (auto&& column : columns)
+    {
+        if (!model.model_schema().contains(column))
+        {
+            this->set_error(error, true);
+            this->error_message() = fmt::format("{} has no column {}", model.type_name(), column);
+            return false;
+        }
+    }
+
+    std::string statement;
+    if (filter)
+    {
+        statement = fmt::format("SELECT {} FROM `{}` WHERE {};", fmt::join(columns, ","), model.table_name(), *filter);
+    }
+    else
+    {
+        statement = fmt::format("SELECT {} FROM `{}`;", fmt::join(columns, ","), model.table_name());
+    }
+
+#ifdef AWESOMEDB_WITH_MARIADB
+    if (const auto native = this->native_connection())
+    {
+        std::string e;
+        const auto result = native->select(statement, nullptr, false, e);
+        if (!result)
+        {
+            this->set_error(error, true);
+            this->error_message() = e;
+            return false;
+        }
+
+        reserve(result->size());
+        while (result->next())
+        {
+            for (std::size_t i = 0; i < cells.size(); ++i)
+            {
+                result->assign(static_cast<int>(i), cells[i]);
+            }
+            append(cells);
+        }
+
+        if (!result->error().empty())
+        {
+            this->set_error(error, true);
+            this->error_message() = result->error();
+            return false;
+        }
+
+        this->set_error(error, false);
+        return true;
+    }
+#endif
+
+    fmt::print("running query: {}\n", statement);
+
+    // forward-only results are not cached by Qt
+    QSqlQuery q(self);
+    q.setForwardOnly(true);
+    if (!q.exec(QString::fromStdString(statement)))
+    {
+        this->set_error(error, true);
+        this->error_message() = q.lastError().text().toStdString();
+        return false;
+    }
+
+    if (q.size() > 0)
+    {
+        reserve(static_cast<std::size_t>(q.size()));
+    }
+
+    // the codecs of the cells are resolved once for all rows
+    std::vector<const utils::ValueCodec*> codecs;
+    codecs.reserve(cells.size());
+    for (auto&& cell : cells)
+    {
+        codecs.emplace_back(&utils::value_codecs[cell.index()]);
+    }
+
+    while (q.next())
+    {
+        for (std::size_t i = 0; i < cells.size(); ++i)
+        {
+            codecs[i]->from_qvariant(cells[i], q.value(static_cast<int>(i)));
+        }
+        append(cells);
+    }
+
+    q.finish();
+    this->set_error(error, false);
+    return true;
+}
+
+std::shared_ptr<QSqlQuery> Database::internal_stream(const Model &model, const std::string *filter, const std::list<std::string> *columns, const std::any &type, bool *error) const
+{
+    // note: the connection stays open on success, the cursor releases it
+
+    if (!this->open(error)) return nullptr;
+
+    // models are constructed directly by the cursor, but only registered models are supported
+    if (std::string e; !is_registered(model, type, e))
+    {
+        this->set_error(error, true);
+        this->error_message() = e;
+        RETURN(nullptr);
+    }
+
+    std::string select;
+    if (std::string e; !select_list(model, columns, select, e))
+    {
+        this->set_error(error, true);
+        this->error_message() = e;
+        RETURN(nullptr);
+    }
+
+    std::string statement;
+    if (filter)
+    {
+        statement = fmt::format("SELECT {} FROM `{}` WHERE {};", select, model.table_name(), *filter);
+    }
+    else
+    {
+        statement = fmt::format("SELECT {} FROM `{}`;", select, model.table_name());
+    }
+
+    fmt::print("running query: {}\n", statement);
+
+    // forward-only results are not cached by Qt
+    auto q = std::make_shared<QSqlQuery>(self);
+    q->setForwardOnly(true);
+    if (!q->exec(QString::fromStdString(statement)))
+    {
+        this->set_error(error, true);
+        this->error_message() = q->lastError().text().toStdString();
+        RETURN(nullptr);
+    }
+
+    this->set_error(error, false);
+    return q;
 }
 
 bool Database::internal_create_table(const DatabaseTable &table, bool errorWhenExists)
 {
     if (table.empty())
     {
-        this->_lastErrorMessage = fmt::format("{}: no fields specified", table.name());
+        this->error_message() = fmt::format("{}: no fields specified", table.name());
         return false;
     }
 
     bool qerror;
-    const auto res = query(this, qerror, table.generateSqlStatement(!errorWhenExists));
+    const auto res = query(self, qerror, table.generateSqlStatement(!errorWhenExists));
     if (qerror)
     {
-        this->_lastErrorMessage = std::get<1>(res);
+        this->error_message() = std::get<1>(res);
         return false;
     }
     else
     {
-        this->_lastErrorMessage.clear();
+        this->error_message().clear();
     }
 
     return true;
@@ -3,14 +3,59 @@
 #include "model.hpp"
 #include "table.hpp"
 #include "registrar.hpp"
+#include "executor.hpp"
+#include "coroutine.hpp"
+#include "transaction.hpp"
+#include "cursor.hpp"
+#include "pager.hpp"
+#include "columns.hpp"
+#include "record_cache.hpp"
+#include "query_cache.hpp"
+#include "write_buffer.hpp"
 
 #include <string>
+#include <vector>
+#include <array>
 #include <cstdint>
 #include <mutex>
+#include <atomic>
 #include <memory>
+#include <functional>
+#include <optional>
+#include <concepts>
+#include <memory_resource>
+#include <future>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
 
 #include "config.hpp"
 
+class ConnectionPool;
+struct ErrorMessages;
+struct PooledConnection;
+struct StatementKey;
+class QSqlQuery;
+class MariaDbConnection;
+
+/**
+ * Containers which can receive the results of Database::findAll().
+ */
+template<typename Container, typename ModelType>
+concept ModelContainer = std::is_same_v<typename Container::value_type, ModelType> &&
+    requires(Container &container, ModelType &&model) {
+        container.push_back(std::move(model));
+    };
+
+/**
+ * Hit and miss counters of the prepared statement cache.
+ */
+struct StatementCacheStats final
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+};
+
 /**
  * Database Abstraction Library
  */
@@ -37,17 +82,20 @@ public:
     {
         DatabaseRegistrar::register_model<ModelType>(
             [](const Model::Query *query, const Database *db){
-                return std::make_shared<ModelType>(ModelType(query, db));
+                // constructed in place, the constructor is private
+                return std::shared_ptr<ModelType>(new ModelType(query, db));
         });
     }
 
     /**
      * Initializes a new database with the given configuration.
+     * When the native MariaDB backend was requested but isn't available in
+     * this build, QtSql is used and the last error message is set, see backend().
      */
     explicit Database(const DatabaseConfig &config = {});
 
     /**
-     * Closes the database connection and cleans up all allocated resources.
+     * Closes all pooled database connections and cleans up all allocated resources.
      */
     ~Database();
 
@@ -69,6 +117,23 @@ public:
      */
     bool createTable(const DatabaseTable &table, bool errorWhenExists = false);
 
+    /**
+     * Creates the table of the given model from the SQL type mapping of its schema.
+     * Fails when an attribute has a type without a known SQL type.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    bool createTable(bool errorWhenExists = false)
+    {
+        std::string error_message;
+        const auto table = ModelType::schema().table(&error_message);
+        if (table.empty())
+        {
+            this->error_message() = error_message;
+            return false;
+        }
+        return this->createTable(table, errorWhenExists);
+    }
+
     /**
      * Drops a table from the database.
      */
@@ -86,34 +151,318 @@ public:
      */
     bool canConnect() const;
 
+    /**
+     * Returns the backend which is used for reads, may differ from the
+     * configured one when it isn't available in this build.
+     */
+    inline DatabaseBackend backend() const
+    { return this->_config.backend; }
+
     /**
      * Receives the last error message from the database server.
+     * Error messages are tracked separately for every calling thread.
+     */
+    inline const std::string &lastErrorMessage() const
+    { return this->error_message(); }
+
+    /**
+     * Begins a transaction on the connection of the calling thread.
+     * The connection stays checked out until the transaction is committed
+     * or rolled back, so all saves and deletes of this thread share it.
+     * Nested calls join the already running transaction.
+     */
+    bool beginTransaction();
+
+    /**
+     * Commits the transaction of the calling thread. Nested transactions
+     * only commit when the outermost transaction is committed.
+     */
+    bool commitTransaction();
+
+    /**
+     * Rolls back the transaction of the calling thread. Rolling back a
+     * nested transaction makes the outermost commit fail.
+     */
+    bool rollbackTransaction();
+
+    /**
+     * Runs the given function inside a transaction and commits once when it
+     * finished. The transaction is rolled back when the function returns false
+     * or throws an exception, exceptions are rethrown.
+     *
+     * Usage: db.transaction([&](Transaction &tx){ return tx.saveRecord(&model); });
+     */
+    template<typename Function>
+    bool transaction(Function &&function)
+    {
+        Transaction tx(*this);
+        if (!tx.active())
+        {
+            return false;
+        }
+
+        if constexpr (std::is_void_v<std::invoke_result_t<Function, Transaction&>>)
+        {
+            function(tx);
+        }
+        else
+        {
+            if (!function(tx))
+            {
+                tx.rollback();
+                return false;
+            }
+        }
+
+        return tx.commit();
+    }
+
+    /**
+     * Returns the hit and miss counters of the prepared statement cache
+     * summed up over all connections. In steady state only hits are expected.
+     */
+    StatementCacheStats statementCacheStats() const;
+
+    /**
+     * Caches records of the given model type found by id with findRecord(id).
+     * Cached records are returned without a query. Records written with
+     * saveRecord(), upsertRecord(), deleteRecord() and their batch variants
+     * are invalidated, writes of other processes or by raw SQL are only picked
+     * up when the TTL elapsed. A TTL of zero disables the expiry.
+     * Capacity is the approximate maximum amount of cached records of the type.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    void enableRecordCache(std::size_t capacity, std::chrono::milliseconds ttl = std::chrono::milliseconds::zero())
+    {
+        this->_records.configure(typeid(ModelType), capacity, ttl, [](const Model &model) -> std::shared_ptr<const Model> {
+            return std::make_shared<const ModelType>(static_cast<const ModelType&>(model));
+        });
+    }
+
+    /**
+     * Stops caching records of the given model type.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    void disableRecordCache()
+    {
+        this->_records.remove(typeid(ModelType));
+    }
+
+    /**
+     * Drops all cached records, use this after modifying cached tables with raw SQL.
+     */
+    void clearRecordCache();
+
+    /**
+     * Returns the counters of the record cache.
+     */
+    RecordCacheStats recordCacheStats() const;
+
+    /**
+     * Caches the result sets of findAllCached() for the given model type.
+     * Entries are keyed by the normalized filter and invalidated when the
+     * table of the model is written with saveRecord(), upsertRecord(),
+     * deleteRecord(), their batch variants, deleteWhere(), execute(),
+     * truncateTable() or dropTable(). Writes of other processes are only
+     * picked up when the TTL elapsed. A TTL of zero disables the expiry.
+     * Capacity is the maximum amount of cached result sets of the type.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    void enableQueryCache(std::size_t capacity, std::chrono::milliseconds ttl = std::chrono::milliseconds::zero())
+    {
+        this->_queries.configure(typeid(ModelType), capacity, ttl);
+    }
+
+    /**
+     * Stops caching result sets of the given model type.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    void disableQueryCache()
+    {
+        this->_queries.remove(typeid(ModelType));
+    }
+
+    /**
+     * Drops all cached result sets.
      */
-    constexpr inline const auto &lastErrorMessage() const
-    { return this->_lastErrorMessage; }
+    void clearQueryCache();
+
+    /**
+     * Returns the counters of the query cache.
+     */
+    QueryCacheStats queryCacheStats() const;
+
+    /**
+     * Buffers saveRecord() of existing records of the given model type.
+     * Saves are queued per record and repeated saves of the same record are
+     * merged into one pending save of all changed attributes. A background
+     * thread writes the pending saves in batches when write_behind_interval
+     * elapsed or write_behind_batch_size saves are pending, see DatabaseConfig.
+     * Pending saves are written by flush() and when the database is destroyed.
+     *
+     * Until then reads return the previous values of the records. New records,
+     * saves inside a transaction and the batch functions write immediately,
+     * pending saves of the same records are written before. Inside a transaction
+     * they are written outside of it on a separate pooled connection, which
+     * requires a free slot in the connection pool.
+     *
+     * Buffered saves are written with batched UPDATE statements and bypass
+     * custom save logic of the model, see MODEL_CUSTOM_SAVE(). Don't enable
+     * write-behind for model types which override save().
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    void enableWriteBehind()
+    {
+        this->_writes->configure(typeid(ModelType), [](const Model &model) -> std::unique_ptr<Model> {
+            return std::make_unique<ModelType>(static_cast<const ModelType&>(model));
+        });
+    }
+
+    /**
+     * Stops buffering saves of the given model type,
+     * pending saves are still written.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    void disableWriteBehind()
+    {
+        this->_writes->remove(typeid(ModelType));
+    }
+
+    /**
+     * Writes all pending saves of the write-behind buffer.
+     * Failed saves stay pending and are retried by the next flush.
+     */
+    bool flush();
+
+    /**
+     * Returns the amount of pending saves of the write-behind buffer.
+     */
+    std::size_t pendingWrites() const;
 
     /**
      * Saves the given model back to the database.
+     * Saves of model types with write-behind are buffered, see enableWriteBehind().
      */
     bool saveRecord(Model *model);
 
+    /**
+     * Saves all models of the given range. Accepts ranges of models
+     * and ranges of pointers to models.
+     *
+     * New records are grouped by model type and inserted with multi-row
+     * INSERT statements which stay below max_allowed_packet. The generated
+     * ids are assigned back to the models, this requires consecutive auto
+     * increment values (innodb_autoinc_lock_mode 0 or 1, default in MariaDB).
+     * With the interleaved lock mode 2 (default in MySQL 8) new records are
+     * inserted one by one instead.
+     * Changed existing records are grouped by model type and changed columns
+     * and updated with one UPDATE statement per chunk.
+     *
+     * Chunks are committed independently unless the call is wrapped in a transaction.
+     * The models are written directly, custom save logic of the model is not
+     * called, see MODEL_CUSTOM_SAVE(). Use saveRecord() for such models.
+     */
+    template<typename Range>
+    bool saveRecords(Range &&models)
+    {
+        const auto pointers = to_model_pointers(std::forward<Range>(models));
+        if (!this->write_pending(pointers)) return false;
+        const auto status = this->internal_save_records(pointers);
+        this->invalidate_records(pointers);
+        return status;
+    }
+
+    /**
+     * Inserts the given model or updates the existing record when the insert
+     * conflicts with the primary key or a unique key. Only changed columns
+     * are updated. Models without id receive the id of the inserted or
+     * updated record, no prior lookup is needed.
+     * Custom save logic of the model is not called, see MODEL_CUSTOM_SAVE().
+     */
+    bool upsertRecord(Model *model);
+
+    /**
+     * Upserts all models of the given range. Accepts ranges of models
+     * and ranges of pointers to models.
+     *
+     * Models with id are grouped by model type and changed columns and
+     * written with multi-row statements. Models without id are upserted
+     * one by one to obtain their ids. Custom save logic of the model is
+     * not called, see MODEL_CUSTOM_SAVE().
+     */
+    template<typename Range>
+    bool upsertRecords(Range &&models)
+    {
+        const auto pointers = to_model_pointers(std::forward<Range>(models));
+        if (!this->write_pending(pointers)) return false;
+        const auto status = this->internal_upsert_records(pointers);
+        this->invalidate_records(pointers);
+        return status;
+    }
+
     /**
      * Deletes the given model from the database.
+     * Pending saves of a deleted record are dropped, see enableWriteBehind().
      */
     bool deleteRecord(Model *model);
 
+    /**
+     * Deletes all records of the given model type with the given ids
+     * without loading them. Accepts any range of ids. The ids are sent
+     * in chunks of DELETE ... WHERE id IN (...) statements.
+     * Returns the amount of deleted records.
+     */
+    template<typename ModelType, typename Range, DATABSE_ENABLE_IF_MODEL>
+    std::uint64_t deleteRecords(const Range &ids, bool *error = nullptr)
+    {
+        const std::vector<id_t> list(std::begin(ids), std::end(ids));
+        const auto deleted = this->internal_delete_ids(std::string{ModelType::tableName()}, list, error);
+        for (auto&& id : list)
+        {
+            this->invalidate_record(typeid(ModelType), id);
+        }
+        this->invalidate_table(std::string{ModelType::tableName()});
+        return deleted;
+    }
+
+    /**
+     * Deletes all records of the given model type matching the filter pattern
+     * without loading them. When a batch size is given, the records are deleted
+     * in batches of at most that many rows, each in its own statement, so row
+     * locks are only held for a short time. Returns the amount of deleted records.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    std::uint64_t deleteWhere(const std::string &filter, std::uint64_t batchSize = 0, bool *error = nullptr)
+    {
+        const auto deleted = this->internal_delete_where(std::string{ModelType::tableName()}, filter, batchSize, error);
+        this->invalidate_record(typeid(ModelType), 0);
+        this->invalidate_table(std::string{ModelType::tableName()});
+        return deleted;
+    }
+
     /**
      * Finds the given model record for the given id.
      */
     template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
     ModelType findRecord(id_t id, bool *error = nullptr) const
     {
-        const std::lock_guard lock{this->_mutex};
+        // cached records are returned without a query, see enableRecordCache()
+        std::uint64_t token;
+        if (const auto cached = this->cached_record(typeid(ModelType), id, token))
+        {
+            this->set_error(error, false);
+            return static_cast<const ModelType&>(*cached);
+        }
+
+        std::optional<ModelType> result;
         if (!this->open(error)) return {};
-        const auto result = this->internal_find(ModelType(), &id, nullptr, std::any(ModelType()), error);
+        this->internal_find(ModelType(), &id, nullptr, nullptr, std::any(ModelType()), this->row_sink(result), error);
+        if (result) this->cache_record(*result, token);
         this->close();
 
-        return result ? (*dynamic_cast<const ModelType*>(result.get())) : ModelType{};
+        if (!result) return {};
+        return std::move(*result);
     }
 
     /**
@@ -123,12 +472,13 @@ public:
     template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
     ModelType findRecord(const std::string filter, bool *error = nullptr) const
     {
-        const std::lock_guard lock{this->_mutex};
+        std::optional<ModelType> result;
         if (!this->open(error)) return {};
-        const auto result = this->internal_find(ModelType(), nullptr, &filter, std::any(ModelType()), error);
+        this->internal_find(ModelType(), nullptr, &filter, nullptr, std::any(ModelType()), this->row_sink(result), error);
         this->close();
 
-        return result ? (*dynamic_cast<const ModelType*>(result.get())) : ModelType{};
+        if (!result) return {};
+        return std::move(*result);
     }
 
     /**
@@ -137,17 +487,9 @@ public:
     template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
     std::list<ModelType> findAll(bool *error = nullptr) const
     {
-        const std::lock_guard lock{this->_mutex};
-        if (!this->open(error)) return {};
-        const auto results = this->internal_find_all(ModelType(), nullptr, std::any(ModelType()), error);
-        this->close();
-
-        std::list<ModelType> casted_results;
-        for (auto&& res : results)
-        {
-            casted_results.emplace_back(*dynamic_cast<const ModelType*>(res.get()));
-        }
-        return casted_results;
+        std::list<ModelType> results;
+        if (!this->findAll<ModelType>(results, error)) return {};
+        return results;
     }
 
     /**
@@ -157,37 +499,611 @@ public:
     template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
     std::list<ModelType> findAll(const std::string &filter, bool *error = nullptr) const
     {
-        const std::lock_guard lock{this->_mutex};
-        if (!this->open(error)) return {};
-        const auto results = this->internal_find_all(ModelType(), &filter, std::any(ModelType()), error);
-        this->close();
+        std::list<ModelType> results;
+        if (!this->findAll<ModelType>(results, filter, error)) return {};
+        return results;
+    }
 
-        std::list<ModelType> casted_results;
-        for (auto&& res : results)
+    /**
+     * Finds the records matching the filter pattern, an empty filter finds the entire table.
+     * The result set is an immutable snapshot which is shared with other callers
+     * when the query cache is enabled for the model type, see enableQueryCache().
+     * Cache hits don't copy any models. Returns an empty result set on failure.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    std::shared_ptr<const std::vector<ModelType>> findAllCached(const std::string &filter = {}, bool *error = nullptr) const
+    {
+        const std::string table{ModelType::tableName()};
+        const auto key = QueryCache::normalize(filter);
+
+        std::uint64_t generation;
+        if (const auto cached = this->cached_query(typeid(ModelType), table, key, generation))
         {
-            casted_results.emplace_back(*dynamic_cast<const ModelType*>(res.get()));
+            this->set_error(error, false);
+            return std::static_pointer_cast<const std::vector<ModelType>>(cached);
         }
-        return casted_results;
+
+        // the snapshot may outlive memory resources of the caller
+        const Model::AllocationScope scope{std::pmr::get_default_resource()};
+        auto results = std::make_shared<std::vector<ModelType>>();
+        const auto success = key.empty() ?
+            this->findAll<ModelType>(*results, error) :
+            this->findAll<ModelType>(*results, filter, error);
+        if (!success) return std::make_shared<const std::vector<ModelType>>();
+
+        this->cache_query(typeid(ModelType), table, key, results, generation);
+        return results;
+    }
+
+    /**
+     * Finds the given model record for the given id, loading only the given columns.
+     * The id is always loaded. Attributes which were not selected keep their default
+     * value and are reported by Model::is_loaded(). Inserts and upserts of such a
+     * partially loaded model fail, updates only write the changed columns.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    ModelType findRecord(id_t id, const std::list<std::string> &columns, bool *error = nullptr) const
+    {
+        std::optional<ModelType> result;
+        if (!this->open(error)) return {};
+        this->internal_find(ModelType(), &id, nullptr, &columns, std::any(ModelType()), this->row_sink(result), error);
+        this->close();
+
+        if (!result) return {};
+        return std::move(*result);
+    }
+
+    /**
+     * Finds the records matching the filter pattern, loading only the given columns.
+     * See findRecord(id, columns) for the behavior of partially loaded models.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    std::list<ModelType> findAll(const std::string &filter, const std::list<std::string> &columns, bool *error = nullptr) const
+    {
+        std::list<ModelType> results;
+        if (!this->findAll<ModelType>(results, filter, columns, error)) return {};
+        return results;
+    }
+
+    /**
+     * Appends the entire table of the given model to the given container.
+     * Every row is constructed once and moved into the container, vectors
+     * are reserved upfront when the size of the result set is known.
+     * The models of std::pmr containers allocate from the resource of the container.
+     * Returns false on failure, rows appended before the failure are kept.
+     */
+    template<typename ModelType, typename Container, DATABSE_ENABLE_IF_MODEL>
+        requires ModelContainer<Container, ModelType>
+    bool findAll(Container &results, bool *error = nullptr) const
+    {
+        if (!this->open(error)) return false;
+        const Model::AllocationScope scope{memory_resource(results)};
+        const auto success = this->internal_find_all(ModelType(), nullptr, nullptr, std::any(ModelType()), this->row_sink<ModelType>(results), error);
+        this->close();
+        return success;
+    }
+
+    /**
+     * Appends the records matching the filter pattern to the given container.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, typename Container, DATABSE_ENABLE_IF_MODEL>
+        requires ModelContainer<Container, ModelType>
+    bool findAll(Container &results, const std::string &filter, bool *error = nullptr) const
+    {
+        if (!this->open(error)) return false;
+        const Model::AllocationScope scope{memory_resource(results)};
+        const auto success = this->internal_find_all(ModelType(), &filter, nullptr, std::any(ModelType()), this->row_sink<ModelType>(results), error);
+        this->close();
+        return success;
+    }
+
+    /**
+     * Appends the records matching the filter pattern to the given container,
+     * loading only the given columns.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, typename Container, DATABSE_ENABLE_IF_MODEL>
+        requires ModelContainer<Container, ModelType>
+    bool findAll(Container &results, const std::string &filter, const std::list<std::string> &columns, bool *error = nullptr) const
+    {
+        if (!this->open(error)) return false;
+        const Model::AllocationScope scope{memory_resource(results)};
+        const auto success = this->internal_find_all(ModelType(), &filter, &columns, std::any(ModelType()), this->row_sink<ModelType>(results), error);
+        this->close();
+        return success;
+    }
+
+    /**
+     * Finds the entire table of the given model, the result set and the attribute
+     * storage of its models are allocated from the given memory resource.
+     * With a std::pmr::monotonic_buffer_resource the whole result set is freed in
+     * one step. The models must not outlive the resource, copy them to keep them.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    std::pmr::vector<ModelType> findAll(std::pmr::memory_resource *resource, bool *error = nullptr) const
+    {
+        std::pmr::vector<ModelType> results{resource};
+        if (!this->findAll<ModelType>(results, error)) return std::pmr::vector<ModelType>{resource};
+        return results;
+    }
+
+    /**
+     * Finds the records matching the filter pattern using the given memory resource.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    std::pmr::vector<ModelType> findAll(std::pmr::memory_resource *resource, const std::string &filter, bool *error = nullptr) const
+    {
+        std::pmr::vector<ModelType> results{resource};
+        if (!this->findAll<ModelType>(results, filter, error)) return std::pmr::vector<ModelType>{resource};
+        return results;
+    }
+
+    /**
+     * Finds the records matching the filter pattern using the given memory resource,
+     * loading only the given columns.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    std::pmr::vector<ModelType> findAll(std::pmr::memory_resource *resource, const std::string &filter, const std::list<std::string> &columns, bool *error = nullptr) const
+    {
+        std::pmr::vector<ModelType> results{resource};
+        if (!this->findAll<ModelType>(results, filter, columns, error)) return std::pmr::vector<ModelType>{resource};
+        return results;
+    }
+
+    /**
+     * Reads the given columns of the entire table into typed contiguous buffers
+     * without constructing any models, one buffer per column type. Meant for
+     * aggregations over a few columns of many rows, see ColumnBuffer.
+     */
+    template<typename ModelType, ColumnType... Types>
+        requires std::is_base_of_v<Model, ModelType> && (sizeof...(Types) > 0)
+    ColumnSet<Types...> findColumns(const std::array<std::string, sizeof...(Types)> &columns, bool *error = nullptr) const
+    {
+        return this->find_columns<ModelType, Types...>(nullptr, columns, error);
+    }
+
+    /**
+     * Reads the given columns of the records matching the filter pattern into typed buffers.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, ColumnType... Types>
+        requires std::is_base_of_v<Model, ModelType> && (sizeof...(Types) > 0)
+    ColumnSet<Types...> findColumns(const std::string &filter, const std::array<std::string, sizeof...(Types)> &columns, bool *error = nullptr) const
+    {
+        return this->find_columns<ModelType, Types...>(&filter, columns, error);
+    }
+
+    /**
+     * Streams the entire table of the given model through a forward-only cursor.
+     * Only one model is kept in memory at a time. The connection of the calling
+     * thread stays checked out until the cursor is destroyed or exhausted.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    ModelCursor<ModelType> stream(bool *error = nullptr) const
+    {
+        return ModelCursor<ModelType>(this, this->internal_stream(ModelType(), nullptr, nullptr, std::any(ModelType()), error));
+    }
+
+    /**
+     * Streams the records matching the filter pattern through a forward-only cursor.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    ModelCursor<ModelType> stream(const std::string &filter, bool *error = nullptr) const
+    {
+        return ModelCursor<ModelType>(this, this->internal_stream(ModelType(), &filter, nullptr, std::any(ModelType()), error));
+    }
+
+    /**
+     * Streams the records matching the filter pattern, loading only the given columns.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    ModelCursor<ModelType> stream(const std::string &filter, const std::list<std::string> &columns, bool *error = nullptr) const
+    {
+        return ModelCursor<ModelType>(this, this->internal_stream(ModelType(), &filter, &columns, std::any(ModelType()), error), true);
+    }
+
+    /**
+     * Streams the entire table of the given model, the attribute storage of every
+     * model is allocated from the given memory resource. The storage of a row is
+     * only released to the resource when the cursor advances, use a pool resource
+     * like std::pmr::unsynchronized_pool_resource to reuse it for the next row.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    ModelCursor<ModelType> stream(std::pmr::memory_resource *resource, bool *error = nullptr) const
+    {
+        return ModelCursor<ModelType>(this, this->internal_stream(ModelType(), nullptr, nullptr, std::any(ModelType()), error), false, resource);
+    }
+
+    /**
+     * Streams the records matching the filter pattern using the given memory resource.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    ModelCursor<ModelType> stream(std::pmr::memory_resource *resource, const std::string &filter, bool *error = nullptr) const
+    {
+        return ModelCursor<ModelType>(this, this->internal_stream(ModelType(), &filter, nullptr, std::any(ModelType()), error), false, resource);
+    }
+
+    /**
+     * Streams the records matching the filter pattern using the given memory resource,
+     * loading only the given columns.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    ModelCursor<ModelType> stream(std::pmr::memory_resource *resource, const std::string &filter, const std::list<std::string> &columns, bool *error = nullptr) const
+    {
+        return ModelCursor<ModelType>(this, this->internal_stream(ModelType(), &filter, &columns, std::any(ModelType()), error), true, resource);
+    }
+
+    /**
+     * Iterates the entire table of the given model page by page using keyset
+     * pagination on the id. The next page is prefetched on the executor while
+     * the caller works on the current page.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    ModelPager<ModelType> pages(std::size_t pageSize) const
+    {
+        return this->pages<ModelType>(pageSize, {});
+    }
+
+    /**
+     * Iterates the records matching the filter pattern page by page.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    ModelPager<ModelType> pages(std::size_t pageSize, const std::string &filter) const
+    {
+        return ModelPager<ModelType>(pageSize, [this, pageSize, filter](id_t last_id){
+            const auto condition = filter.empty() ?
+                fmt::format("id > {}", last_id) :
+                fmt::format("({}) AND id > {}", filter, last_id);
+            return this->findAllAsync<ModelType>(fmt::format("{} ORDER BY id LIMIT {}", condition, pageSize));
+        });
+    }
+
+    /**
+     * Asynchronous variant of findRecord(id).
+     * The query runs on the internal executor using its own connection.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    std::future<DatabaseResult<ModelType>> findRecordAsync(id_t id) const
+    {
+        return this->async<ModelType>([this, id](bool *error){
+            return this->findRecord<ModelType>(id, error);
+        });
+    }
+
+    /**
+     * Asynchronous variant of findRecord(filter).
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    std::future<DatabaseResult<ModelType>> findRecordAsync(const std::string &filter) const
+    {
+        return this->async<ModelType>([this, filter](bool *error){
+            return this->findRecord<ModelType>(filter, error);
+        });
+    }
+
+    /**
+     * Asynchronous variant of findAll().
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    std::future<DatabaseResult<std::list<ModelType>>> findAllAsync() const
+    {
+        return this->async<std::list<ModelType>>([this](bool *error){
+            return this->findAll<ModelType>(error);
+        });
+    }
+
+    /**
+     * Asynchronous variant of findAll(filter).
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DATABSE_ENABLE_IF_MODEL>
+    std::future<DatabaseResult<std::list<ModelType>>> findAllAsync(const std::string &filter) const
+    {
+        return this->async<std::list<ModelType>>([this, filter](bool *error){
+            return this->findAll<ModelType>(filter, error);
+        });
+    }
+
+    /**
+     * Asynchronous variant of saveRecord().
+     * The model must stay alive and must not be accessed until the future is ready.
+     */
+    std::future<DatabaseResult<bool>> saveRecordAsync(Model *model);
+
+    /**
+     * Asynchronous variant of deleteRecord().
+     * The model must stay alive and must not be accessed until the future is ready.
+     */
+    std::future<DatabaseResult<bool>> deleteRecordAsync(Model *model);
+
+    /**
+     * Awaitable variant of findRecord(id) for coroutines.
+     * The query runs on the internal executor, the awaiting coroutine
+     * is resumed on the given scheduler.
+     */
+    template<typename ModelType, DatabaseScheduler Scheduler, DATABSE_ENABLE_IF_MODEL>
+    DatabaseAwaitable<ModelType, Scheduler> coFindRecord(Scheduler &scheduler, id_t id) const
+    {
+        return this->awaitable<ModelType>(scheduler, [this, id](bool *error){
+            return this->findRecord<ModelType>(id, error);
+        });
+    }
+
+    /**
+     * Awaitable variant of findRecord(filter) for coroutines.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DatabaseScheduler Scheduler, DATABSE_ENABLE_IF_MODEL>
+    DatabaseAwaitable<ModelType, Scheduler> coFindRecord(Scheduler &scheduler, const std::string &filter) const
+    {
+        return this->awaitable<ModelType>(scheduler, [this, filter](bool *error){
+            return this->findRecord<ModelType>(filter, error);
+        });
+    }
+
+    /**
+     * Awaitable variant of findAll() for coroutines.
+     */
+    template<typename ModelType, DatabaseScheduler Scheduler, DATABSE_ENABLE_IF_MODEL>
+    DatabaseAwaitable<std::list<ModelType>, Scheduler> coFindAll(Scheduler &scheduler) const
+    {
+        return this->awaitable<std::list<ModelType>>(scheduler, [this](bool *error){
+            return this->findAll<ModelType>(error);
+        });
+    }
+
+    /**
+     * Awaitable variant of findAll(filter) for coroutines.
+     * The filter pattern is NOT injection protected!! Don't use user data for the filter.
+     */
+    template<typename ModelType, DatabaseScheduler Scheduler, DATABSE_ENABLE_IF_MODEL>
+    DatabaseAwaitable<std::list<ModelType>, Scheduler> coFindAll(Scheduler &scheduler, const std::string &filter) const
+    {
+        return this->awaitable<std::list<ModelType>>(scheduler, [this, filter](bool *error){
+            return this->findAll<ModelType>(filter, error);
+        });
+    }
+
+    /**
+     * Awaitable variant of saveRecord() for coroutines.
+     * The model must stay alive and must not be accessed until the coroutine was resumed.
+     */
+    template<DatabaseScheduler Scheduler>
+    DatabaseAwaitable<bool, Scheduler> coSaveRecord(Scheduler &scheduler, Model *model)
+    {
+        return this->awaitable<bool>(scheduler, [this, model](bool *error){
+            const auto status = this->saveRecord(model);
+            this->set_error(error, !status);
+            return status;
+        });
+    }
+
+    /**
+     * Awaitable variant of execute() for coroutines.
+     */
+    template<DatabaseScheduler Scheduler>
+    DatabaseAwaitable<bool, Scheduler> coExecute(Scheduler &scheduler, const std::string &query)
+    {
+        return this->awaitable<bool>(scheduler, [this, query](bool *error){
+            const auto status = this->execute(query);
+            this->set_error(error, !status);
+            return status;
+        });
     }
 
 private:
     friend class Model;
+    friend class QueryCursor;
 
     // disable copy
     Database(const Database &other) = delete;
     Database &operator= (const Database &other) = delete;
 
     DatabaseConfig _config;
-    mutable std::string _lastErrorMessage;
-    mutable std::recursive_mutex _mutex;
-    void *dbptr = nullptr; // pointer to QSqlDatabase for internal use
+    std::shared_ptr<ErrorMessages> _errors; // per-thread error messages, erased when the thread exits
+    std::shared_ptr<ConnectionPool> _pool;
+    std::unique_ptr<DatabaseExecutor> _executor;
+    std::unique_ptr<WriteBuffer> _writes;
+    mutable std::atomic<std::uint64_t> _statement_hits{0};
+    mutable std::atomic<std::uint64_t> _statement_misses{0};
+    mutable RecordCache _records;
+    mutable QueryCache _queries;
 
     // internal helper functions
+    // open() checks out the connection of the calling thread, close() returns it to the pool
     bool open(bool *error = nullptr) const;
     void close() const;
+    PooledConnection *connection() const;
+    std::string &error_message() const;
+
+    // returns a cached prepared statement of the calling thread's connection,
+    // the statement is prepared on a cache miss, returns nullptr when preparing failed
+    std::shared_ptr<QSqlQuery> prepared(const StatementKey &key, const std::function<std::string()> &generate) const;
     void set_error(bool *error = nullptr, bool = true) const;
 
-    const std::shared_ptr<Model> internal_find(const Model &model, const id_t *id, const std::string *filter, const std::any &type, bool *error = nullptr) const;
-    const std::list<std::shared_ptr<Model>> internal_find_all(const Model &model, const std::string *filter, const std::any &type, bool *error = nullptr) const;
+    // record cache maintenance, records are neither looked up nor cached inside a transaction,
+    // records written inside a transaction are invalidated again when it ends,
+    // id 0 invalidates all records of the type
+    std::shared_ptr<const Model> cached_record(const std::type_index &type, id_t id, std::uint64_t &token) const;
+    void cache_record(const Model &model, std::uint64_t token) const;
+    void invalidate_record(const std::type_index &type, id_t id) const;
+    void invalidate_records(const std::vector<Model*> &models) const;
+    void finish_transaction(PooledConnection *connection) const;
+
+    // query cache maintenance, result sets are neither looked up nor cached
+    // inside a transaction, an empty table name invalidates all tables
+    std::shared_ptr<const void> cached_query(const std::type_index &type, const std::string &table, const std::string &filter, std::uint64_t &generation) const;
+    void cache_query(const std::type_index &type, const std::string &table, const std::string &filter, std::shared_ptr<const void> result, std::uint64_t generation) const;
+    void invalidate_table(const std::string &table) const;
+
+    // write-behind, buffer_record() returns false when the save must be written directly,
+    // write_pending() writes the pending saves of records which are written directly
+    bool buffer_record(Model *model, bool &status);
+    bool write_pending(const std::vector<Model*> &models);
+    bool write_buffered(const std::vector<Model*> &models, std::string &error);
+
+    // runs the given function and captures its error state
+    template<typename ResultType, typename Function>
+    DatabaseResult<ResultType> capture(const Function &function) const
+    {
+        bool error = false;
+        DatabaseResult<ResultType> result{function(&error)};
+        result.error = error;
+        if (error)
+        {
+            result.errorMessage = this->lastErrorMessage();
+        }
+        return result;
+    }
+
+    // runs the given function on the executor
+    template<typename ResultType, typename Function>
+    std::future<DatabaseResult<ResultType>> async(Function &&function) const
+    {
+        return this->_executor->submit([this, function = std::forward<Function>(function)]{
+            return this->capture<ResultType>(function);
+        });
+    }
+
+    // runs the given function on the executor when awaited and resumes on the scheduler
+    template<typename ResultType, DatabaseScheduler Scheduler, typename Function>
+    DatabaseAwaitable<ResultType, Scheduler> awaitable(Scheduler &scheduler, Function &&function) const
+    {
+        return {this->_executor.get(), scheduler, [this, function = std::forward<Function>(function)]{
+            return this->capture<ResultType>(function);
+        }};
+    }
+
+    // receives the rows of a result set, reserve() is called before the first row
+    // when the size of the result set is known, emplace() constructs the model
+    struct RowSink
+    {
+        std::function<void(std::size_t rows)> reserve;
+        std::function<void(const Model::Query *query)> emplace;
+    };
+
+    // memory resource of std::pmr containers, nullptr for all other containers
+    template<typename Container>
+    static std::pmr::memory_resource *memory_resource(const Container &container)
+    {
+        if constexpr (requires { { container.get_allocator().resource() } -> std::convertible_to<std::pmr::memory_resource*>; })
+        {
+            return container.get_allocator().resource();
+        }
+        else
+        {
+            return nullptr;
+        }
+    }
+
+    // constructs the row in place at the end of the container
+    template<typename ModelType, typename Container>
+    RowSink row_sink(Container &results) const
+    {
+        return {
+            [&results](std::size_t rows) {
+                if constexpr (requires { results.reserve(rows); })
+                {
+                    results.reserve(results.size() + rows);
+                }
+            },
+            [this, &results](const Model::Query *query) {
+                results.push_back(ModelType(query, this));
+            },
+        };
+    }
+
+    // constructs a single row in place
+    template<typename ModelType>
+    RowSink row_sink(std::optional<ModelType> &result) const
+    {
+        return {
+            [](std::size_t) {},
+            [this, &result](const Model::Query *query) {
+                result.emplace(ModelType(query, this));
+            },
+        };
+    }
+
+    template<typename ModelType, typename... Types>
+    ColumnSet<Types...> find_columns(const std::string *filter, const std::array<std::string, sizeof...(Types)> &columns, bool *error) const
+    {
+        ColumnSet<Types...> result;
+
+        // one cell per column, decoded in place and moved into the buffers
+        std::vector<utils::Value> cells{utils::Value{std::in_place_type<std::optional<Types>>}...};
+
+        if (!this->open(error)) return result;
+        const auto success = this->internal_find_columns(ModelType(), filter, {columns.begin(), columns.end()}, cells,
+            [&](std::size_t rows) { result.reserve(rows); },
+            [&](std::vector<utils::Value> &row) { result.append(row); },
+            error);
+        this->close();
+
+        if (!success) return {};
+        return result;
+    }
+
+    // columns selects a projection, nullptr selects all columns
+    bool internal_find(const Model &model, const id_t *id, const std::string *filter, const std::list<std::string> *columns, const std::any &type, const RowSink &sink, bool *error = nullptr) const;
+    std::shared_ptr<QSqlQuery> internal_stream(const Model &model, const std::string *filter, const std::list<std::string> *columns, const std::any &type, bool *error = nullptr) const;
+    bool internal_find_all(const Model &model, const std::string *filter, const std::list<std::string> *columns, const std::any &type, const RowSink &sink, bool *error = nullptr) const;
+    bool internal_find_columns(const Model &model, const std::string *filter, const std::vector<std::string> &columns, std::vector<utils::Value> &cells,
+                               const std::function<void(std::size_t rows)> &reserve, const std::function<void(std::vector<utils::Value> &cells)> &append, bool *error) const;
+
+#ifdef AWESOMEDB_WITH_MARIADB
+    // returns the native connection of the calling thread's connection or nullptr when reads
+    // must use QtSql, reads inside a transaction must see its uncommitted changes
+    MariaDbConnection *native_connection() const;
+
+    // reads models with the native backend, statements with an id are cached on the connection
+    bool internal_select_native(MariaDbConnection *native, const std::string &statement, const id_t *id, bool projected, const RowSink &sink, bool *error) const;
+#endif
+
     bool internal_create_table(const DatabaseTable &table, bool errorWhenExists = false);
+    std::uint64_t internal_delete_ids(const std::string &table, const std::vector<id_t> &ids, bool *error);
+    std::uint64_t internal_delete_where(const std::string &table, const std::string &filter, std::uint64_t batch_size, bool *error);
+
+    // batched writes
+    template<typename Range>
+    static std::vector<Model*> to_model_pointers(Range &&models)
+    {
+        std::vector<Model*> pointers;
+        if constexpr (requires { std::size(models); })
+        {
+            pointers.reserve(std::size(models));
+        }
+        for (auto&& model : models)
+        {
+            if constexpr (std::is_pointer_v<std::remove_cvref_t<decltype(model)>>)
+            {
+                pointers.emplace_back(model);
+            }
+            else
+            {
+                pointers.emplace_back(&model);
+            }
+        }
+        return pointers;
+    }
+
+    static std::size_t estimate_row_size(const Model *model, const std::vector<std::size_t> &slots);
+    bool validate_records(const std::vector<Model*> &models) const;
+    void query_batch_limits(std::uint64_t &max_packet_size, std::uint64_t &id_increment, bool &consecutive_ids) const;
+    bool internal_save_records(const std::vector<Model*> &models);
+    bool internal_insert_records(const std::vector<Model*> &models, std::uint64_t max_packet_size, std::uint64_t id_increment, bool consecutive_ids);
+    bool internal_update_records(const std::vector<Model*> &models, const std::list<std::string> &columns, std::uint64_t max_packet_size);
+    bool internal_upsert_records(const std::vector<Model*> &models);
+    bool internal_upsert_group(const std::vector<Model*> &models, const std::list<std::string> &changed_columns, bool with_id, std::uint64_t max_packet_size);
 };
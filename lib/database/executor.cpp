@@ -0,0 +1,72 @@
+#include "executor.hpp"
+
+#include <algorithm>
+
+DatabaseExecutor::DatabaseExecutor(std::size_t threads, std::size_t queue_depth)
+    : _thread_count(std::max<std::size_t>(threads, 1)),
+      _queue_depth(std::max<std::size_t>(queue_depth, 1))
+{
+}
+
+DatabaseExecutor::~DatabaseExecutor()
+{
+    {
+        const std::lock_guard lock{this->_mutex};
+        this->_stopping = true;
+    }
+    this->_not_empty.notify_all();
+    this->_not_full.notify_all();
+
+    // workers drain the remaining queue before they exit
+    for (auto&& worker : this->_workers)
+    {
+        worker.join();
+    }
+}
+
+void DatabaseExecutor::enqueue(std::function<void()> task)
+{
+    std::unique_lock lock{this->_mutex};
+
+    // start workers on first use
+    if (this->_workers.empty())
+    {
+        this->_workers.reserve(this->_thread_count);
+        for (std::size_t i = 0; i < this->_thread_count; ++i)
+        {
+            this->_workers.emplace_back(&DatabaseExecutor::run, this);
+        }
+    }
+
+    this->_not_full.wait(lock, [&]{
+        return this->_queue.size() < this->_queue_depth || this->_stopping; });
+
+    this->_queue.emplace_back(std::move(task));
+    lock.unlock();
+    this->_not_empty.notify_one();
+}
+
+void DatabaseExecutor::run()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock lock{this->_mutex};
+            this->_not_empty.wait(lock, [&]{
+                return !this->_queue.empty() || this->_stopping; });
+
+            if (this->_queue.empty())
+            {
+                // stopping and nothing left to do
+                return;
+            }
+
+            task = std::move(this->_queue.front());
+            this->_queue.pop_front();
+        }
+        this->_not_full.notify_one();
+
+        task();
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <future>
+#include <functional>
+#include <type_traits>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+/**
+ * Result of an asynchronous database operation.
+ * The error message is captured on the worker thread.
+ */
+template<typename ValueType>
+struct DatabaseResult final
+{
+    ValueType value;
+    bool error = false;
+    std::string errorMessage;
+};
+
+/**
+ * Bounded worker pool for asynchronous database queries.
+ *
+ * Worker threads are started lazily on the first submitted task.
+ * Every worker uses its own database connection from the connection
+ * pool. When the queue is full, submitting blocks until a worker
+ * picked up a pending task. Pending tasks are still executed when
+ * the executor is destroyed.
+ */
+class DatabaseExecutor final
+{
+public:
+    DatabaseExecutor(std::size_t threads, std::size_t queue_depth);
+    ~DatabaseExecutor();
+
+    /**
+     * Schedules the given function on a worker thread and returns
+     * a future for its result.
+     */
+    template<typename Function>
+    auto submit(Function &&function) -> std::future<std::invoke_result_t<Function>>
+    {
+        using result_t = std::invoke_result_t<Function>;
+
+        // std::function requires copyable targets, std::packaged_task isn't
+        auto task = std::make_shared<std::packaged_task<result_t()>>(std::forward<Function>(function));
+        auto future = task->get_future();
+        this->enqueue([task]{ (*task)(); });
+        return future;
+    }
+
+private:
+    DatabaseExecutor(const DatabaseExecutor &other) = delete;
+    DatabaseExecutor &operator= (const DatabaseExecutor &other) = delete;
+
+    const std::size_t _thread_count;
+    const std::size_t _queue_depth;
+
+    std::mutex _mutex;
+    std::condition_variable _not_empty;
+    std::condition_variable _not_full;
+    std::deque<std::function<void()>> _queue;
+    std::vector<std::thread> _workers;
+    bool _stopping = false;
+
+    void enqueue(std::function<void()> task);
+    void run();
+};
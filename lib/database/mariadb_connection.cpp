@@ -0,0 +1,581 @@
+#include "mariadb_connection.hpp"
+
+#ifdef AWESOMEDB_WITH_MARIADB
+
+#include <vector>
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+#include <type_traits>
+
+#include <mysql.h>
+#include <errmsg.h>
+
+#include <QString>
+#include <QByteArray>
+#include <QDateTime>
+
+#include <fmt/format.h>
+
+#include <utils/qvariant_mapper.hpp>
+
+// the binary protocol only supports positional placeholders
+static std::string positional_placeholders(const std::string &statement)
+{
+    std::string result;
+    result.reserve(statement.size());
+
+    char quote = 0;
+    for (std::size_t i = 0; i < statement.size(); ++i)
+    {
+        const auto c = statement[i];
+        if (quote)
+        {
+            if (c == quote) quote = 0;
+            result += c;
+        }
+        else if (c == '\'' || c == '"' || c == '`')
+        {
+            quote = c;
+            result += c;
+        }
+        else if (c == ':' && i + 1 < statement.size() && (std::isalpha(static_cast<unsigned char>(statement[i + 1])) || statement[i + 1] == '_'))
+        {
+            while (i + 1 < statement.size() && (std::isalnum(static_cast<unsigned char>(statement[i + 1])) || statement[i + 1] == '_'))
+            {
+                ++i;
+            }
+            result += '?';
+        }
+        else
+        {
+            result += c;
+        }
+    }
+
+    return result;
+}
+
+// the connection was closed by the server, the statement can be retried after reconnecting
+static bool connection_lost(unsigned int error)
+{
+    return error == CR_SERVER_GONE_ERROR || error == CR_SERVER_LOST;
+}
+
+MariaDbConnection::MariaDbConnection(const DatabaseConfig &config)
+    : _config(config)
+{
+}
+
+MariaDbConnection::~MariaDbConnection()
+{
+    this->disconnect();
+}
+
+bool MariaDbConnection::connect(std::string &error)
+{
+    this->_mysql = mysql_init(nullptr);
+    if (!this->_mysql)
+    {
+        error = "out of memory";
+        return false;
+    }
+
+    mysql_options(this->_mysql, MYSQL_SET_CHARSET_NAME, "utf8mb4");
+
+    if (!mysql_real_connect(this->_mysql,
+            this->_config.host.c_str(),
+            this->_config.username.c_str(),
+            this->_config.password.c_str(),
+            this->_config.database.c_str(),
+            this->_config.port, nullptr, 0))
+    {
+        error = mysql_error(this->_mysql);
+        this->disconnect();
+        return false;
+    }
+
+    return true;
+}
+
+void MariaDbConnection::disconnect()
+{
+    // prepared statements don't survive a reconnect
+    for (auto&& [text, statement] : this->_statements)
+    {
+        mysql_stmt_close(statement.stmt);
+    }
+    this->_statements.clear();
+
+    if (this->_mysql)
+    {
+        mysql_close(this->_mysql);
+        this->_mysql = nullptr;
+    }
+}
+
+bool MariaDbConnection::busy() const
+{
+    return std::any_of(this->_statements.begin(), this->_statements.end(), [](auto &&statement){
+        return statement.second.busy; });
+}
+
+std::unique_ptr<MariaDbResult> MariaDbConnection::select(const std::string &statement, const std::uint64_t *id, bool cached, std::string &error)
+{
+    if (!this->_mysql && !this->connect(error))
+    {
+        return nullptr;
+    }
+
+    const auto text = positional_placeholders(statement);
+    fmt::print("running native query: {}\n", text);
+
+    unsigned int error_code = 0;
+    auto result = this->execute(text, id, cached, error, error_code);
+    if (!result && connection_lost(error_code))
+    {
+        // reconnecting closes all statements, result sets of the outer queries
+        // still reference their cached statements
+        if (this->busy())
+        {
+            error = fmt::format("connection lost while a result set is still in use: {}", error);
+            return nullptr;
+        }
+
+        // the server may have closed the connection in the meantime (wait_timeout)
+        this->disconnect();
+        if (!this->connect(error))
+        {
+            return nullptr;
+        }
+        result = this->execute(text, id, cached, error, error_code);
+    }
+
+    return result;
+}
+
+std::unique_ptr<MariaDbResult> MariaDbConnection::execute(const std::string &statement, const std::uint64_t *id, bool cached, std::string &error, unsigned int &error_code)
+{
+    MYSQL_STMT *stmt = nullptr;
+    bool *busy = nullptr;
+
+    // statements still used by an outer result set are busy
+    const auto it = this->_statements.find(statement);
+    if (cached && it != this->_statements.end() && !it->second.busy)
+    {
+        stmt = it->second.stmt;
+        busy = &it->second.busy;
+    }
+    else
+    {
+        stmt = mysql_stmt_init(this->_mysql);
+        if (!stmt)
+        {
+            error = mysql_error(this->_mysql);
+            error_code = mysql_errno(this->_mysql);
+            return nullptr;
+        }
+
+        if (mysql_stmt_prepare(stmt, statement.data(), statement.size()) != 0)
+        {
+            error = mysql_stmt_error(stmt);
+            error_code = mysql_stmt_errno(stmt);
+            mysql_stmt_close(stmt);
+            return nullptr;
+        }
+
+        // let the connector compute the longest value of every column,
+        // string buffers are allocated once per result set
+        const my_bool update_max_length = 1;
+        mysql_stmt_attr_set(stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &update_max_length);
+
+        if (cached && it == this->_statements.end())
+        {
+            const auto inserted = this->_statements.emplace(statement, Statement{stmt, false});
+            busy = &inserted.first->second.busy;
+        }
+    }
+
+    // the result takes ownership of uncached statements
+    std::unique_ptr<MariaDbResult> result{new MariaDbResult(stmt, busy)};
+
+    if (mysql_stmt_param_count(stmt) > 0)
+    {
+        if (!id || mysql_stmt_param_count(stmt) != 1)
+        {
+            error = "unsupported statement parameters";
+            return nullptr;
+        }
+
+        MYSQL_BIND param;
+        std::memset(&param, 0, sizeof(param));
+        param.buffer_type = MYSQL_TYPE_LONGLONG;
+        param.buffer = const_cast<std::uint64_t*>(id);
+        param.is_unsigned = 1;
+        if (mysql_stmt_bind_param(stmt, &param) != 0)
+        {
+            error = mysql_stmt_error(stmt);
+            return nullptr;
+        }
+    }
+
+    if (mysql_stmt_execute(stmt) != 0 || mysql_stmt_store_result(stmt) != 0)
+    {
+        error = mysql_stmt_error(stmt);
+        error_code = mysql_stmt_errno(stmt);
+        return nullptr;
+    }
+
+    if (!result->bind())
+    {
+        error = result->error();
+        return nullptr;
+    }
+
+    return result;
+}
+
+namespace {
+
+enum class Kind
+{
+    Signed,
+    Unsigned,
+    Real,
+    Time,
+    Text,
+    Binary,
+};
+
+// result buffer of a single column
+struct Column
+{
+    std::string name;
+    enum_field_types type;
+    Kind kind;
+    long long integer = 0;
+    double real = 0;
+    MYSQL_TIME time;
+    std::vector<char> text;
+    unsigned long length = 0;
+    my_bool is_null = 0;
+    my_bool error = 0;
+};
+
+}
+
+/**
+ * Result buffers of all columns, bound once per result set.
+ */
+struct MariaDbResult::Columns
+{
+    std::vector<Column> columns;
+    std::vector<MYSQL_BIND> binds;
+};
+
+static Kind column_kind(const MYSQL_FIELD &field)
+{
+    switch (field.type)
+    {
+        case MYSQL_TYPE_TINY:
+        case MYSQL_TYPE_SHORT:
+        case MYSQL_TYPE_INT24:
+        case MYSQL_TYPE_LONG:
+        case MYSQL_TYPE_LONGLONG:
+        case MYSQL_TYPE_YEAR:
+            return (field.flags & UNSIGNED_FLAG) ? Kind::Unsigned : Kind::Signed;
+        case MYSQL_TYPE_FLOAT:
+        case MYSQL_TYPE_DOUBLE:
+            return Kind::Real;
+        case MYSQL_TYPE_DATE:
+        case MYSQL_TYPE_TIME:
+        case MYSQL_TYPE_DATETIME:
+        case MYSQL_TYPE_TIMESTAMP:
+            return Kind::Time;
+        default:
+            // charset 63 is binary
+            return field.charsetnr == 63 ? Kind::Binary : Kind::Text;
+    }
+}
+
+MariaDbResult::MariaDbResult(MYSQL_STMT *stmt, bool *busy)
+    : _stmt(stmt),
+      _busy(busy),
+      _columns(std::make_unique<Columns>())
+{
+    if (this->_busy) (*this->_busy) = true;
+}
+
+MariaDbResult::~MariaDbResult()
+{
+    mysql_stmt_free_result(this->_stmt);
+
+    if (this->_busy)
+    {
+        (*this->_busy) = false;
+    }
+    else
+    {
+        mysql_stmt_close(this->_stmt);
+    }
+}
+
+bool MariaDbResult::bind()
+{
+    MYSQL_RES *metadata = mysql_stmt_result_metadata(this->_stmt);
+    if (!metadata)
+    {
+        this->_error = "statement has no result set";
+        return false;
+    }
+
+    const auto count = mysql_num_fields(metadata);
+    const auto fields = mysql_fetch_fields(metadata);
+
+    auto &columns = this->_columns->columns;
+    auto &binds = this->_columns->binds;
+    columns.resize(count);
+    binds.resize(count);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        auto &column = columns[i];
+        auto &bind = binds[i];
+        std::memset(&bind, 0, sizeof(bind));
+
+        column.name = fields[i].name;
+        column.type = fields[i].type;
+        column.kind = column_kind(fields[i]);
+
+        switch (column.kind)
+        {
+            case Kind::Signed:
+            case Kind::Unsigned:
+                bind.buffer_type = MYSQL_TYPE_LONGLONG;
+                bind.buffer = &column.integer;
+                bind.is_unsigned = column.kind == Kind::Unsigned;
+                break;
+            case Kind::Real:
+                bind.buffer_type = MYSQL_TYPE_DOUBLE;
+                bind.buffer = &column.real;
+                break;
+            case Kind::Time:
+                bind.buffer_type = fields[i].type;
+                bind.buffer = &column.time;
+                break;
+            case Kind::Text:
+            case Kind::Binary:
+                // max_length is known after storing the result set
+                column.text.resize(std::max<unsigned long>(fields[i].max_length, 1));
+                bind.buffer_type = MYSQL_TYPE_STRING;
+                bind.buffer = column.text.data();
+                bind.buffer_length = column.text.size();
+                break;
+        }
+
+        bind.length = &column.length;
+        bind.is_null = &column.is_null;
+        bind.error = &column.error;
+    }
+
+    mysql_free_result(metadata);
+
+    if (mysql_stmt_bind_result(this->_stmt, binds.data()) != 0)
+    {
+        this->_error = mysql_stmt_error(this->_stmt);
+        return false;
+    }
+
+    return true;
+}
+
+bool MariaDbResult::next()
+{
+    const auto status = mysql_stmt_fetch(this->_stmt);
+    if (status == 0)
+    {
+        return true;
+    }
+    if (status == MYSQL_DATA_TRUNCATED)
+    {
+        this->_error = "result column truncated";
+    }
+    else if (status != MYSQL_NO_DATA)
+    {
+        this->_error = mysql_stmt_error(this->_stmt);
+    }
+    return false;
+}
+
+std::size_t MariaDbResult::size() const
+{
+    return static_cast<std::size_t>(mysql_stmt_num_rows(this->_stmt));
+}
+
+int MariaDbResult::index_of(const std::string &column) const
+{
+    const auto &columns = this->_columns->columns;
+    for (std::size_t i = 0; i < columns.size(); ++i)
+    {
+        if (columns[i].name == column)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+static QDate to_date(const MYSQL_TIME &time)
+{
+    return QDate(time.year, time.month, time.day);
+}
+
+static QTime to_time(const MYSQL_TIME &time)
+{
+    return QTime(time.hour, time.minute, time.second, time.second_part / 1000);
+}
+
+template<typename T>
+static void assign_column(T &target, const Column &column)
+{
+    if constexpr (utils::is_optional_v<T>)
+    {
+        if (column.is_null)
+        {
+            target.reset();
+            return;
+        }
+        typename T::value_type value{};
+        assign_column(value, column);
+        target = std::move(value);
+    }
+    else if (column.is_null)
+    {
+        // same as a NULL QVariant
+        target = T{};
+    }
+    else if constexpr (std::is_same_v<T, std::string>)
+    {
+        switch (column.kind)
+        {
+            case Kind::Signed:   target = std::to_string(column.integer); break;
+            case Kind::Unsigned: target = std::to_string(static_cast<unsigned long long>(column.integer)); break;
+            case Kind::Real:     target = fmt::format("{}", column.real); break;
+            case Kind::Time:     target = QDateTime(to_date(column.time), to_time(column.time)).toString(Qt::ISODate).toStdString(); break;
+            case Kind::Text:
+            case Kind::Binary:   target.assign(column.text.data(), column.length); break;
+        }
+    }
+    else if constexpr (std::is_arithmetic_v<T>)
+    {
+        switch (column.kind)
+        {
+            case Kind::Signed:   target = static_cast<T>(column.integer); break;
+            case Kind::Unsigned: target = static_cast<T>(static_cast<unsigned long long>(column.integer)); break;
+            case Kind::Real:     target = static_cast<T>(column.real); break;
+            case Kind::Time:     target = T{}; break;
+            case Kind::Text:
+            case Kind::Binary:
+            {
+                // decimal columns are transferred as text
+                const auto begin = column.text.data();
+                if constexpr (std::is_same_v<T, bool>)
+                {
+                    long long value = 0;
+                    std::from_chars(begin, begin + column.length, value);
+                    target = value != 0;
+                }
+                else
+                {
+                    target = T{};
+                    std::from_chars(begin, begin + column.length, target);
+                }
+                break;
+            }
+        }
+    }
+    else if constexpr (std::is_same_v<T, QDateTime> || std::is_same_v<T, QDate> || std::is_same_v<T, QTime>)
+    {
+        if (column.kind == Kind::Time)
+        {
+            if constexpr (std::is_same_v<T, QDateTime>) target = QDateTime(to_date(column.time), to_time(column.time));
+            if constexpr (std::is_same_v<T, QDate>)     target = to_date(column.time);
+            if constexpr (std::is_same_v<T, QTime>)     target = to_time(column.time);
+        }
+        else
+        {
+            target = T{};
+        }
+    }
+}
+
+bool MariaDbResult::assign(int index, utils::Value &value) const
+{
+    if (index < 0 || static_cast<std::size_t>(index) >= this->_columns->columns.size())
+    {
+        // missing columns are decoded as NULL
+        static const Column null = []{ Column c; c.kind = Kind::Text; c.is_null = 1; return c; }();
+        return std::visit([&](auto &target) {
+            using T = std::decay_t<decltype(target)>;
+            if constexpr (std::is_same_v<T, std::any>)
+            {
+                return utils::any_from_qvariant(target, QVariant());
+            }
+            else
+            {
+                assign_column(target, null);
+                return true;
+            }
+        }, value);
+    }
+
+    const auto &column = this->_columns->columns[index];
+    return std::visit([&](auto &target) {
+        using T = std::decay_t<decltype(target)>;
+        if constexpr (std::is_same_v<T, std::any>)
+        {
+            // user-defined types are converted by the registries
+            return utils::any_from_qvariant(target, this->value(index));
+        }
+        else
+        {
+            assign_column(target, column);
+            return true;
+        }
+    }, value);
+}
+
+QVariant MariaDbResult::value(int index) const
+{
+    if (index < 0 || static_cast<std::size_t>(index) >= this->_columns->columns.size())
+    {
+        return QVariant();
+    }
+
+    const auto &column = this->_columns->columns[index];
+    if (column.is_null)
+    {
+        return QVariant();
+    }
+
+    switch (column.kind)
+    {
+        case Kind::Signed:   return QVariant::fromValue(static_cast<qlonglong>(column.integer));
+        case Kind::Unsigned: return QVariant::fromValue(static_cast<qulonglong>(column.integer));
+        case Kind::Real:     return QVariant::fromValue(column.real);
+        case Kind::Text:     return QVariant::fromValue(QString::fromUtf8(column.text.data(), column.length));
+        case Kind::Binary:   return QVariant::fromValue(QByteArray(column.text.data(), column.length));
+        case Kind::Time:
+            switch (column.type)
+            {
+                case MYSQL_TYPE_DATE: return QVariant::fromValue(to_date(column.time));
+                case MYSQL_TYPE_TIME: return QVariant::fromValue(to_time(column.time));
+                default:              return QVariant::fromValue(QDateTime(to_date(column.time), to_time(column.time)));
+            }
+    }
+
+    return QVariant();
+}
+
+#endif // AWESOMEDB_WITH_MARIADB
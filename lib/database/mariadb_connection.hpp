@@ -0,0 +1,103 @@
+#pragma once
+
+#include "config.hpp"
+#include "native_row.hpp"
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
+
+// note: this header is for internal use only, the implementation
+// requires a build with AWESOMEDB_WITH_MARIADB
+
+struct st_mysql;
+struct st_mysql_stmt;
+
+class MariaDbResult;
+
+/**
+ * Database connection using the MariaDB C connector directly.
+ *
+ * Queries use the binary prepared statement protocol, result columns are
+ * bound to native buffers and decoded straight into model attributes.
+ * The connection is owned by a pooled connection and bound to its thread.
+ */
+class MariaDbConnection final
+{
+public:
+    MariaDbConnection(const DatabaseConfig &config);
+    ~MariaDbConnection();
+
+    /**
+     * Executes a SELECT statement with an optional id parameter. Named
+     * placeholders are accepted like in QtSql statements. Cached statements
+     * stay prepared on the connection, this is meant for statements generated
+     * from the model schema. Returns nullptr and sets the error message on failure.
+     *
+     * A lost connection is reestablished once, unless a result set of a cached
+     * statement is still alive. Reconnecting would close its statement, the
+     * query fails instead.
+     */
+    std::unique_ptr<MariaDbResult> select(const std::string &statement, const std::uint64_t *id, bool cached, std::string &error);
+
+private:
+    MariaDbConnection(const MariaDbConnection &other) = delete;
+    MariaDbConnection &operator= (const MariaDbConnection &other) = delete;
+
+    struct Statement
+    {
+        st_mysql_stmt *stmt = nullptr;
+        bool busy = false; // a result set of the statement is still alive
+    };
+
+    bool connect(std::string &error);
+    void disconnect();
+    bool busy() const; // any cached statement has a result set alive
+    std::unique_ptr<MariaDbResult> execute(const std::string &statement, const std::uint64_t *id, bool cached, std::string &error, unsigned int &error_code);
+
+    const DatabaseConfig _config;
+    st_mysql *_mysql = nullptr;
+    std::unordered_map<std::string, Statement> _statements;
+};
+
+/**
+ * Result set of a native query, rows are fetched one by one.
+ */
+class MariaDbResult final : public NativeRow
+{
+public:
+    ~MariaDbResult();
+
+    /**
+     * Fetches the next row, returns false at the end of the result set
+     * or when fetching failed.
+     */
+    bool next();
+
+    // amount of rows in the result set
+    std::size_t size() const;
+
+    // error message of the last failed fetch
+    const std::string &error() const
+    { return this->_error; }
+
+    int index_of(const std::string &column) const override;
+    bool assign(int index, utils::Value &value) const override;
+    QVariant value(int index) const override;
+
+private:
+    friend class MariaDbConnection;
+
+    struct Columns;
+
+    MariaDbResult(st_mysql_stmt *stmt, bool *busy);
+
+    // binds the result buffers, must be called after the result set was stored
+    bool bind();
+
+    st_mysql_stmt *_stmt;
+    bool *_busy; // flag of the cached statement, nullptr when the result owns the statement
+    std::unique_ptr<Columns> _columns;
+    std::string _error;
+};
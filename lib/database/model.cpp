@@ -1,6 +1,9 @@
 #include "model.hpp"
 
 #include <database/database.hpp>
+#include <database/connection_pool.hpp>
+#include <database/statement_cache.hpp>
+#include <database/native_row.hpp>
 #include <utils/any_comparator.hpp>
 #include <utils/any_formatter.hpp>
 #include <utils/qvariant_mapper.hpp>
@@ -9,13 +12,28 @@
 
 #include <QSqlDatabase>
 #include <QSqlQuery>
+#include <QSqlRecord>
 #include <QSqlError>
 #include <QVariant>
 #include <QDebug>
+#include <stdexcept>
+
+namespace {
+
+// schema under construction on the current thread, see Model::build_schema()
+struct SchemaBuilder final
+{
+    const std::type_info *type = nullptr;
+    ModelSchema *schema = nullptr;
+};
+
+thread_local SchemaBuilder schema_builder;
+
+} // anonymous namespace
 
 Model::Model()
 {
-    this->make_model_attribute<id_t>("id", 0);
+    // the primary key is added by build_schema()
 }
 
 Model::Model(const Query *query, const Database *db)
@@ -29,86 +47,362 @@ Model::~Model()
 
 QVariant Model::Query::value(const std::string &fieldName) const
 {
+    if (this->row) return this->row->value(this->row->index_of(fieldName));
     if (!this->query) return QVariant();
     return this->query->value(QString::fromStdString(fieldName));
 }
 
+QVariant Model::Query::value(int index) const
+{
+    if (this->row) return this->row->value(index);
+    if (!this->query || index < 0) return QVariant();
+    return this->query->value(index);
+}
+
+int Model::Query::index_of(const std::string &fieldName) const
+{
+    if (this->row) return this->row->index_of(fieldName);
+    if (!this->query) return -1;
+    return this->query->record().indexOf(QString::fromStdString(fieldName));
+}
+
+bool Model::Query::contains(const std::string &fieldName) const
+{
+    return this->index_of(fieldName) != -1;
+}
+
+ModelSchema Model::build_schema(const std::type_info &type, std::string_view table_name, void (*prototype)())
+{
+    ModelSchema schema;
+    schema._table_name = table_name;
+    schema.add("id", id_t{0}, utils::value_codec<id_t>(), std::type_index(typeid(id_t)), false);
+
+    // a prototype constructor may build the schema of other model types,
+    // restore the previous state when done
+    struct Restore final
+    {
+        SchemaBuilder builder = schema_builder;
+        const Model *prototype = _schema_prototype;
+        bool slots_used = _schema_slots_used;
+        ~Restore()
+        {
+            schema_builder = builder;
+            _schema_prototype = prototype;
+            _schema_slots_used = slots_used;
+        }
+    } restore;
+
+    schema_builder = {&type, &schema};
+    _schema_prototype = nullptr;
+    _schema_slots_used = false;
+
+    // records the attributes through make_model_attribute()
+    prototype();
+
+    schema.generate_statements();
+    return schema;
+}
+
+void Model::bind_schema(Model *model, const std::type_info &type, const ModelSchema &(*schema)())
+{
+    // first instance of the type under construction is the prototype
+    if (schema_builder.type && *schema_builder.type == type && !_schema_prototype)
+    {
+        _schema_prototype = model;
+        model->_schema = schema_builder.schema;
+        model->_values.assign({schema_builder.schema->default_value(id_slot)});
+        model->_changed.resize(1);
+        model->_unloaded.resize(1);
+        return;
+    }
+
+    const auto &s = schema();
+    model->_schema = &s;
+    model->_values.assign(s._defaults.begin(), s._defaults.end());
+    model->_changed.resize(s.size());
+    model->_unloaded.resize(s.size());
+}
+
+void Model::record_model_attribute(std::string_view name, value_t &&value, const utils::ValueCodec &codec, const std::type_index &column_type, bool nullable)
+{
+    const auto size = schema_builder.schema->size();
+    schema_builder.schema->add(name, std::move(value), codec, column_type, nullable);
+
+    // keep the prototype usable within its constructor
+    const auto slot = schema_builder.schema->slot(name);
+    if (schema_builder.schema->size() != size)
+    {
+        this->_values.emplace_back(schema_builder.schema->default_value(slot));
+        this->_changed.resize(this->_values.size());
+        this->_unloaded.resize(this->_values.size());
+    }
+    else
+    {
+        this->_values[slot] = schema_builder.schema->default_value(slot);
+    }
+}
+
+void Model::erase_model_attribute(std::string_view name)
+{
+    const auto slot = schema_builder.schema->find(name);
+    if (slot == ModelSchema::npos || slot == id_slot)
+    {
+        return;
+    }
+
+    // accessors cache their slot in a function-local static
+    if (_schema_slots_used)
+    {
+        throw std::logic_error(fmt::format("{}: attribute {} removed after attribute slots were used",
+            schema_builder.schema->table_name(), name));
+    }
+
+    schema_builder.schema->remove(name);
+    this->_values.erase(this->_values.begin() + slot);
+    this->_changed.resize(this->_values.size());
+    this->_unloaded.resize(this->_values.size());
+}
+
+const std::list<Model::key_t> Model::attribute_columns() const
+{
+    const auto &columns = this->_schema->columns();
+    return std::list<key_t>(std::next(columns.begin(), id_slot + 1), columns.end());
+}
+
+const std::vector<std::size_t> Model::attribute_slots(const std::list<key_t> &columns) const
+{
+    std::vector<std::size_t> slots;
+    slots.reserve(columns.size());
+    for (auto&& column : columns)
+    {
+        slots.emplace_back(this->_schema->slot(column));
+    }
+    return slots;
+}
+
 bool Model::has_model_attributes() const
 {
-    // remove id column
-    auto columns = this->_columns;
-    columns.erase(std::find(columns.begin(), columns.end(), "id"));
+    // check if there is anything besides the id
+    return this->_schema->size() > 1;
+}
+
+void Model::merge_changes(const Model &other)
+{
+    other._changed.for_each([&](std::size_t slot){
+        this->_values[slot] = other._values[slot];
+        this->_changed.set(slot);
+        this->_unloaded.reset(slot);
+    });
+}
+
+// generates "(?,?),(?,?)" for the given amount of columns and rows
+static std::string placeholder_rows(std::size_t columns, std::size_t rows)
+{
+    std::string placeholders = "(?";
+    for (std::size_t i = 1; i < columns; ++i)
+    {
+        placeholders += ",?";
+    }
+    placeholders += ")";
+
+    std::string values;
+    values.reserve(rows * (placeholders.size() + 1));
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+        if (i != 0) values += ",";
+        values += placeholders;
+    }
+    return values;
+}
+
+const std::string Model::generate_batch_insert_query(std::size_t rows) const
+{
+    const auto columns = this->attribute_columns();
 
-    // check if empty
-    return !columns.empty();
+    return fmt::format("INSERT INTO `{}` ({}) VALUES {};",
+        this->table_name(), utils::list_join(columns, ","), placeholder_rows(columns.size(), rows));
 }
 
-const std::string Model::generate_insert_query() const
+const std::string Model::generate_batch_update_query(const std::list<key_t> &columns, std::size_t rows) const
 {
-    // remove id column
-    auto columns = this->_columns;
-    columns.erase(std::find(columns.begin(), columns.end(), "id"));
+    // every column gets its value picked by id: col=CASE id WHEN ? THEN ? ... ELSE col END
+    std::string when;
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+        when += " WHEN ? THEN ?";
+    }
+
+    std::list<std::string> query_pairs;
+    for (auto&& column : columns)
+    {
+        query_pairs.emplace_back(fmt::format("{}=CASE id{} ELSE {} END", column, when, column));
+    }
 
-    const auto format = utils::list_join(columns, ",");
-    const auto values = ":" + utils::list_join(columns, ",:");
+    std::string ids = "?";
+    for (std::size_t i = 1; i < rows; ++i)
+    {
+        ids += ",?";
+    }
 
-    return fmt::format("INSERT INTO `{}` ({}) VALUES ({});",
-        this->table_name(), format, values);
+    return fmt::format("UPDATE `{}` SET {} WHERE id IN ({});",
+        this->table_name(), utils::list_join(query_pairs, ","), ids);
 }
 
-const std::string Model::generate_update_query() const
+const std::string Model::generate_upsert_query(const std::list<key_t> &changed_columns, bool with_id, std::size_t rows) const
 {
-    // remove id column
-    auto columns = this->_columns;
-    columns.erase(std::find(columns.begin(), columns.end(), "id"));
+    const auto &all_columns = this->_schema->columns();
+    const auto columns = with_id ? std::list<key_t>(all_columns.begin(), all_columns.end()) : this->attribute_columns();
+
+    // only changed columns are updated on conflict,
+    // id=LAST_INSERT_ID(id) reports the id of the updated row as last insert id
+    std::list<std::string> query_pairs;
+    for (auto&& column : changed_columns)
+    {
+        query_pairs.emplace_back(fmt::format("{}=VALUES({})", column, column));
+    }
+    query_pairs.emplace_back("id=LAST_INSERT_ID(id)");
 
+    return fmt::format("INSERT INTO `{}` ({}) VALUES {} ON DUPLICATE KEY UPDATE {};",
+        this->table_name(), utils::list_join(columns, ","), placeholder_rows(columns.size(), rows),
+        utils::list_join(query_pairs, ","));
+}
+
+const std::string Model::generate_update_query(const std::list<key_t> &columns) const
+{
     std::list<std::string> query_pairs;
-    for (auto&& attr : this->_attributes)
+    for (auto&& column : columns)
+    {
+        query_pairs.emplace_back(fmt::format("{}=:{}", column, column));
+    }
+
+    return fmt::format("UPDATE `{}` SET {} WHERE id=:id;",
+        this->table_name(), utils::list_join(query_pairs, ","));
+}
+
+const std::list<Model::key_t> Model::changed_fields() const
+{
+    std::list<key_t> columns;
+    this->_changed.for_each([&](std::size_t slot){
+        if (slot != id_slot)
+        {
+            columns.emplace_back(this->_schema->column(slot));
+        }
+    });
+    return columns;
+}
+
+const std::list<Model::key_t> Model::diff(const Model &other) const
+{
+    std::list<key_t> columns;
+    for (std::size_t slot = 0; slot < this->_values.size(); ++slot)
     {
-        if (attr.first == "id") continue;
+        // models of the same type share the slots, otherwise match by column name
+        const auto other_slot = this->_schema == other._schema ? slot :
+            other._schema->find(this->_schema->column(slot));
+        if (other_slot == ModelSchema::npos)
+        {
+            columns.emplace_back(this->_schema->column(slot));
+            continue;
+        }
 
-        // only update changed values
-        if (std::get<1>(attr.second))
+        bool success;
+        const auto equal = this->_schema->codec(slot).compare(this->attribute(slot), other.attribute(other_slot), &success);
+        if (!success || !equal)
         {
-            query_pairs.emplace_back(fmt::format("{}=:{}", attr.first, attr.first));
+            columns.emplace_back(this->_schema->column(slot));
         }
     }
 
-    // nothing to update
-    if (query_pairs.empty())
+    // columns which only exist in the other model
+    if (this->_schema != other._schema)
     {
-        return {};
+        for (auto&& column : other._schema->columns())
+        {
+            if (!this->_schema->contains(column))
+            {
+                columns.emplace_back(column);
+            }
+        }
     }
 
-    return fmt::format("UPDATE `{}` SET {} WHERE id={};",
-        this->table_name(), utils::list_join(query_pairs, ","), this->id());
+    return columns;
 }
 
-void Model::construct_default(const Query *query)
+const std::list<Model::key_t> Model::unloaded_columns() const
 {
-    // iterate and fetch data on a best guess basis
-    for (auto&& attr : this->_columns)
+    std::list<key_t> columns;
+    this->_unloaded.for_each([&](std::size_t slot){
+        columns.emplace_back(this->_schema->column(slot));
+    });
+    return columns;
+}
+
+bool Model::check_fully_loaded(const Database *db) const
+{
+    if (!this->_unloaded.any())
     {
-        utils::any_from_qvariant(
-            this->get_attribute(attr),
-            query->query->value(QString::fromStdString(attr)));
+        return true;
     }
+    const auto columns = this->unloaded_columns();
 
-    // mark model as unchanged
-    this->reset_changed_state();
+    // writing the defaults would overwrite the actual values in the database
+    db->error_message() = fmt::format("refusing to write columns of {} which were not loaded: {}",
+        this->type_name(), utils::list_join(columns, ","));
+    return false;
 }
 
-bool Model::has_changes() const
+void Model::construct_default(const Query *query)
 {
-    for (auto&& attr : this->_attributes)
+    // resolve the column ordinals once per result set, every following
+    // row of the same model type is decoded by index without string work
+    if (query->ordinals_schema != this->_schema)
     {
-        if (std::get<1>(attr.second))
+        query->ordinals.clear();
+        query->ordinals.reserve(this->_schema->size());
+        if (query->row)
         {
-            return true;
+            for (auto&& attr : this->_schema->columns())
+            {
+                query->ordinals.emplace_back(query->row->index_of(attr));
+            }
+        }
+        else
+        {
+            const auto record = query->query->record();
+            for (auto&& attr : this->_schema->columns())
+            {
+                query->ordinals.emplace_back(record.indexOf(QString::fromStdString(attr)));
+            }
         }
+        query->ordinals_schema = this->_schema;
     }
 
-    return false;
+    // iterate and fetch data on a best guess basis
+    for (std::size_t slot = 0; slot < this->_values.size(); ++slot)
+    {
+        const auto index = query->ordinals[slot];
+
+        // columns which were not selected keep their default value
+        if (query->projected && index == -1)
+        {
+            this->_unloaded.set(slot);
+            continue;
+        }
+
+        // native backends decode into the attribute storage directly
+        if (query->row)
+        {
+            query->row->assign(index, this->_values[slot]);
+            continue;
+        }
+
+        this->_schema->codec(slot).from_qvariant(
+            this->_values[slot],
+            query->value(index));
+    }
+
+    // mark model as unchanged
+    this->reset_changed_state();
 }
 
 bool Model::is_new_record() const
@@ -116,46 +410,46 @@ bool Model::is_new_record() const
     return this->id() == 0;
 }
 
-void Model::reset_changed_state()
+bool Model::is_loaded(const std::string &column) const
 {
-    for(auto&& attr : this->_attributes)
-    {
-        std::get<1>(attr.second) = false;
-    }
+    const auto slot = this->_schema->find(column);
+    return slot != ModelSchema::npos && !this->_unloaded.test(slot);
 }
 
 bool Model::compare_helper(const Model &other) const
 {
     // attribute count must match
-    if (this->_attributes.size() != other._attributes.size())
+    if (this->_values.size() != other._values.size())
     {
         return false;
     }
 
-    for (auto&& attr_self : this->_attributes)
+    for (std::size_t slot = 0; slot < this->_values.size(); ++slot)
     {
-        for (auto&& attr_other : other._attributes)
+        // models of the same type share the slots, otherwise match by column name
+        const auto other_slot = this->_schema == other._schema ? slot :
+            other._schema->find(this->_schema->column(slot));
+        if (other_slot == ModelSchema::npos)
         {
-            if (attr_self.first == attr_other.first)
-            {
-                bool success;
-                const auto equal = utils::compare_any(
-                    std::get<0>(attr_self.second),
-                    std::get<0>(attr_other.second),
-                    &success);
-
-                if (success == false)
-                {
-                    // unregistered type, assume model is no longer equal
-                    return false;
-                }
-
-                if (!equal)
-                {
-                    // no longer equal, stop and return false
-                    return false;
-                }
-            }
+            return false;
+        }
+
+        bool success;
+        const auto equal = this->_schema->codec(slot).compare(
+            this->attribute(slot),
+            other.attribute(other_slot),
+            &success);
+
+        if (success == false)
+        {
+            // unregistered type, assume model is no longer equal
+            return false;
+        }
+
+        if (!equal)
+        {
+            // no longer equal, stop and return false
+            return false;
         }
     }
 
@@ -170,25 +464,38 @@ bool Model::save(Database *db, id_t *last_insert_id)
     std::string error_message;
     if (!this->is_valid(&error_message))
     {
-        db->_lastErrorMessage = error_message;
+        db->error_message() = error_message;
         return false;
     }
 
     // check if model has attributes
     if (!this->has_model_attributes())
     {
-        db->_lastErrorMessage = "model is empty, please add some attributes first";
+        db->error_message() = "model is empty, please add some attributes first";
         return false;
     }
 
-    QString statement;
+    std::shared_ptr<QSqlQuery> q;
+    std::vector<std::size_t> slots;
     bool did_insert = false;
 
     // record not present in database, insert it
     if (this->is_new_record())
     {
+        // all columns are written, a projected model would lose its unloaded values
+        if (!this->check_fully_loaded(db))
+        {
+            return false;
+        }
+
         // insert query can't be empty
-        statement = QString::fromStdString(this->generate_insert_query());
+        for (std::size_t slot = id_slot + 1; slot < this->_values.size(); ++slot)
+        {
+            slots.emplace_back(slot);
+        }
+        q = db->prepared({std::type_index(typeid(*this)), StatementKind::Insert, {}}, [&]{
+            return this->_schema->insert_statement();
+        });
         did_insert = true;
     }
 
@@ -196,36 +503,44 @@ bool Model::save(Database *db, id_t *last_insert_id)
     else
     {
         // update query can be empty
-        statement = QString::fromStdString(this->generate_update_query());
-        if (statement.isEmpty())
+        const auto columns = this->changed_fields();
+        if (columns.empty())
         {
             // nothing to do, simulate success
             return true;
         }
+
+        // statements are cached per set of changed columns, only those are bound
+        q = db->prepared({std::type_index(typeid(*this)), StatementKind::Update, utils::list_join(columns, ",")}, [&]{
+            return this->generate_update_query(columns);
+        });
+        this->_changed.for_each([&](std::size_t slot){
+            if (slot != id_slot) slots.emplace_back(slot);
+        });
+        slots.emplace_back(id_slot);
     }
 
-    // bind values and execute generated query
-    QSqlQuery q(*static_cast<QSqlDatabase*>(db->dbptr));
-    if (!q.prepare(statement))
+    // error message was set by the database
+    if (!q)
     {
-        db->_lastErrorMessage = q.lastError().text().toStdString();
         return false;
     }
 
-    for (auto&& attr : this->_attributes)
+    // bind values and execute cached statement
+    for (auto&& slot : slots)
     {
-        q.bindValue(
-            QString::fromStdString(":" + attr.first),
-            utils::qvariant_from_any(std::get<0>(attr.second)));
+        q->bindValue(
+            QString::fromStdString(":" + this->_schema->column(slot)),
+            this->attribute_qvariant(slot));
     }
 
-    fmt::print("running prepared query: {}\n", statement.toStdString());
+    fmt::print("running prepared query: {}\n", q->lastQuery().toStdString());
     fmt::print("bound values: ");
-    qDebug() << q.boundValues();
+    qDebug() << q->boundValues();
 
-    if (!q.exec())
+    if (!q->exec())
     {
-        db->_lastErrorMessage = q.lastError().text().toStdString();
+        db->error_message() = q->lastError().text().toStdString();
         return false;
     }
 
@@ -233,7 +548,7 @@ bool Model::save(Database *db, id_t *last_insert_id)
     // and store it in the current model instance
     if (did_insert)
     {
-        const id_t newId = q.lastInsertId().toULongLong();
+        const id_t newId = q->lastInsertId().toULongLong();
         if (newId != 0)
         {
             this->set_id(newId);
@@ -255,14 +570,21 @@ bool Model::remove(Database *db)
         return true;
     }
 
-    const auto statement = fmt::format("DELETE FROM `{}` WHERE id={};", this->table_name(), this->id());
+    const auto q = db->prepared({std::type_index(typeid(*this)), StatementKind::DeleteById, {}}, [&]{
+        return this->_schema->delete_statement();
+    });
+    if (!q)
+    {
+        return false;
+    }
+
+    q->bindValue(":id", QVariant::fromValue(this->id()));
 
-    fmt::print("running query: {}\n", statement);
+    fmt::print("running prepared query: {} [id={}]\n", q->lastQuery().toStdString(), this->id());
 
-    QSqlQuery q(*static_cast<QSqlDatabase*>(db->dbptr));
-    if (!q.exec(QString::fromStdString(statement)))
+    if (!q->exec())
     {
-        db->_lastErrorMessage = q.lastError().text().toStdString();
+        db->error_message() = q->lastError().text().toStdString();
         return false;
     }
 
@@ -278,12 +600,18 @@ const std::string Model::to_string() const
 
     // attributes
     std::list<std::string> formatted_attrs;
-    for (auto&& attr : this->_columns)
+    for (std::size_t slot = id_slot + 1; slot < this->_values.size(); ++slot)
     {
-        if (attr == "id") continue;
+        const auto &attr = this->_schema->column(slot);
+
+        if (this->_unloaded.test(slot))
+        {
+            formatted_attrs.emplace_back(fmt::format("{} = {{not loaded}}", attr));
+            continue;
+        }
 
         bool success;
-        const auto fmt = utils::format_any(std::get<0>(this->_attributes.at(attr)), &success);
+        const auto fmt = this->_schema->codec(slot).format(this->attribute(slot), &success);
         if (success)
         {
             formatted_attrs.emplace_back(fmt::format("{} = {}", attr, fmt));
@@ -2,17 +2,23 @@
 
 #include <string>
 #include <string_view>
-#include <map>
 #include <list>
-#include <tuple>
 #include <any>
 #include <cstdint>
 #include <memory>
+#include <vector>
+#include <memory_resource>
+#include <typeinfo>
+#include <typeindex>
 
 #include <QVariant>
 
 #include <fmt/format.h>
 
+#include "model_schema.hpp"
+
+#include <utils/value.hpp>
+
 #define MODEL_STRING_FMT(type)                                  \
 template<> struct fmt::formatter<type> {                        \
     constexpr auto parse(format_parse_context &ctx)             \
@@ -22,19 +28,25 @@ template<> struct fmt::formatter<type> {                        \
         return format_to(ctx.out(), "{}", var.to_string()); } }
 
 // declares a new public model attribute
+// the slot of the attribute is resolved once per accessor, the slots must not
+// shift afterwards, see remove_model_attribute()
 #define MODEL_ATTRIBUTE(name, type)                       \
     public: inline const type &name() const               \
-    { return this->get_attribute_value<type>(#name); }    \
+    { static const auto slot = this->attribute_slot(#name); \
+      return this->get_attribute_value<type>(slot); }     \
     public: inline void set_##name(const type &value)     \
-    { this->set_attribute_value<type>(#name, value); }    \
+    { static const auto slot = this->attribute_slot(#name); \
+      this->set_attribute_value<type>(slot, value); }     \
     private: // set visibility back to private
 
 // declares a new model attribute with protected setter and public getter
 #define MODEL_ATTRIBUTE_PROTECTED(name, type)             \
     public: inline const type &name() const               \
-    { return this->get_attribute_value<type>(#name); }    \
+    { static const auto slot = this->attribute_slot(#name); \
+      return this->get_attribute_value<type>(slot); }     \
     protected: inline void set_##name(const type &value)  \
-    { this->set_attribute_value<type>(#name, value); }    \
+    { static const auto slot = this->attribute_slot(#name); \
+      this->set_attribute_value<type>(slot, value); }     \
     private: // set visibility back to private
 
 // base model declaration
@@ -43,12 +55,15 @@ template<> struct fmt::formatter<type> {                        \
     private: name(const Query *query, const Database *db);     \
     public: name(const name &other) = default;                 \
     public: name &operator= (const name &other) = default;     \
+    public: name(name &&other) = default;                      \
+    public: name &operator= (name &&other) = default;          \
     public: inline bool operator== (const name &other) const   \
     { return this->compare_helper(other); }                    \
     public: inline bool operator!= (const name &other) const   \
     { return !this->compare_helper(other); }                   \
     private: friend class Database;                            \
     private: friend class Model;                               \
+    private: template<typename> friend class ModelCursor;      \
     public: bool is_valid(std::string *error_message = nullptr) const override; \
     public: inline const std::string table_name() const override {              \
         return __table_name; }                                 \
@@ -58,6 +73,13 @@ template<> struct fmt::formatter<type> {                        \
         return #name; }                                        \
     public: static inline const std::string_view typeName() {  \
         return #name; }                                        \
+    public: static const ModelSchema &schema() {               \
+        static const ModelSchema schema = Model::build_schema( \
+            typeid(name), __table_name, []{ name prototype; }); \
+        return schema; }                                       \
+    private: struct schema_binder { schema_binder(Model *model) { \
+        name::bind_schema(model, typeid(name), &name::schema); } }; \
+    private: [[no_unique_address]] schema_binder _schema_binder{this}; \
     private: // set visibility back to private
 
 #define MODEL(name) \
@@ -76,6 +98,8 @@ template<> struct fmt::formatter<type> {                        \
 // forward declarations
 class Database;
 class QSqlQuery;
+class NativeRow;
+template<typename ModelType> class ModelCursor;
 
 /**
  * Abstract base model representing a record from a database table.
@@ -91,9 +115,17 @@ public:
      */
     struct Query
     {
-        // construct query from QSqlQuery pointer
-        Query(const QSqlQuery *query)
-            : query(query)
+        // construct query from QSqlQuery pointer,
+        // projected result sets only contain a subset of the model columns
+        Query(const QSqlQuery *query, bool projected = false)
+            : query(query),
+              projected(projected)
+        {}
+
+        // construct query from the current row of a native backend
+        Query(const NativeRow *row, bool projected = false)
+            : row(row),
+              projected(projected)
         {}
 
         // return pointer to itself
@@ -102,17 +134,56 @@ public:
         // QSqlQuery::value();
         QVariant value(const std::string &fieldName) const;
 
+        // QSqlQuery::value(); by column ordinal
+        QVariant value(int index) const;
+
+        // column ordinal in the result set, -1 if the column is not present
+        int index_of(const std::string &fieldName) const;
+
+        // checks if the result set contains the given column
+        bool contains(const std::string &fieldName) const;
+
     private:
         friend class Model;
         const QSqlQuery *query = nullptr;
+        const NativeRow *row = nullptr;
+        bool projected = false;
+
+        // column ordinals of the model slots, resolved on the first row
+        // and shared by all models constructed from the same result set
+        mutable const ModelSchema *ordinals_schema = nullptr;
+        mutable std::vector<int> ordinals;
+    };
+
+    /**
+     * Allocates the attribute storage of all models constructed on the
+     * calling thread from the given memory resource while the scope is alive.
+     * A nullptr resource keeps the current one. Copies of such models use the
+     * default resource again, moved models keep the resource and must not
+     * outlive it.
+     */
+    class AllocationScope final
+    {
+    public:
+        AllocationScope(std::pmr::memory_resource *resource)
+            : _previous(_resource)
+        {
+            if (resource) _resource = resource;
+        }
+        ~AllocationScope()
+        { _resource = this->_previous; }
+
+    private:
+        AllocationScope(const AllocationScope &other) = delete;
+        AllocationScope &operator= (const AllocationScope &other) = delete;
+
+        std::pmr::memory_resource *_previous;
     };
 
     // type aliases
     using id_t = std::uint64_t;
     using key_t = std::string;
-    using value_t = std::any;
-    using modified_t = bool;
-    using attribute_t = std::tuple<value_t, modified_t>;
+    using value_t = utils::Value;
 
     // comparison operators
     inline bool operator== (const Model &other) const
@@ -124,8 +195,14 @@ public:
      * Receive a list of all columns of the database model.
      *
      */
-    constexpr inline const auto &columns() const
-    { return this->_columns; }
+    inline const auto &columns() const
+    { return this->_schema->columns(); }
+
+    /**
+     * Returns the attribute layout shared by all instances of the model type.
+     */
+    inline const ModelSchema &model_schema() const
+    { return *this->_schema; }
 
     /**
      * Returns the table name of the model.
@@ -152,13 +229,34 @@ public:
     /**
      * Checks if the model has changed since it was loaded from the database.
      */
-    bool has_changes() const;
+    inline bool has_changes() const
+    { return this->_changed.any(); }
+
+    /**
+     * Returns the attributes changed since the model was loaded or saved,
+     * except the primary key, in column order.
+     */
+    const std::list<key_t> changed_fields() const;
+
+    /**
+     * Returns the attributes which differ from the other model in column order.
+     * Attributes only present in one of the models and values which can't be
+     * compared are reported as different.
+     */
+    const std::list<key_t> diff(const Model &other) const;
 
     /**
      * Checks if the model is a new unsaved record not present in the database.
      */
     bool is_new_record() const;
 
+    /**
+     * Checks if the given attribute holds its database value. Attributes
+     * which were not selected by a column projection are not loaded until
+     * they are assigned a new value.
+     */
+    bool is_loaded(const std::string &column) const;
+
     /**
      * Function which determines if the model qualifies as being valid.
      * User-defined error messages are supported.
@@ -173,55 +271,114 @@ protected:
 
     /**
      * Creates a new model attribute.
+     *
+     * The attributes are recorded once per model type when the schema of the
+     * model is built, see MODEL_DECL(). For all other instances this is a no-op
+     * and the attributes are initialized with the recorded default values.
+     *
+     * The default value is evaluated for the prototype only, so every instance
+     * receives the same value. Per-instance defaults like the current time must
+     * be assigned with the setter in the constructor instead.
      */
     template<typename ValueType>
-    inline void make_model_attribute(const std::string &name, const ValueType &value = {})
+    inline void make_model_attribute(std::string_view name, const ValueType &value = {})
     {
-        this->_attributes.insert({name, std::make_tuple(ValueType{value}, false)});
-        this->_columns.emplace_back(name);
+        if (this == _schema_prototype)
+        {
+            using traits = ModelColumnTraits<ValueType>;
+            this->record_model_attribute(name, utils::make_value<ValueType>(value), utils::value_codec<ValueType>(),
+                std::type_index(typeid(typename traits::type)), traits::nullable);
+        }
     }
 
     /**
      * Removes a attribute from the model.
+     * Like make_model_attribute() this only affects the schema of the model type.
+     *
+     * Removing shifts the slots of the following attributes, which are cached by
+     * the attribute accessors on first use. Throws std::logic_error when a slot
+     * was already looked up while the schema is built, for example by calling
+     * an accessor before removing the attribute in the constructor.
      */
-    inline void remove_model_attribute(const std::string &name)
+    inline void remove_model_attribute(std::string_view name)
     {
-        this->_attributes.erase(name);
-        this->_columns.erase(std::find(this->_columns.begin(), this->_columns.end(), name));
+        if (this == _schema_prototype)
+        {
+            this->erase_model_attribute(name);
+        }
+    }
+
+    /**
+     * Returns the slot of the given attribute.
+     */
+    inline std::size_t attribute_slot(std::string_view key) const
+    {
+        // slots handed out while the schema is built must not shift anymore
+        if (this == _schema_prototype)
+        {
+            _schema_slots_used = true;
+        }
+        return this->_schema->slot(key);
     }
 
     /**
      * Sets the given attribute value.
      */
+    template<typename ValueType>
+    inline void set_attribute_value(std::size_t slot, const ValueType &value)
+    {
+        (*utils::value_cast<ValueType>(&this->_values[slot])) = value;
+        this->_changed.set(slot);
+        this->_unloaded.reset(slot);
+    }
+
     template<typename ValueType>
     inline void set_attribute_value(const std::string &key, const ValueType &value)
     {
-        (*std::any_cast<ValueType>(&std::get<0>(this->_attributes[key]))) = value;
-        std::get<1>(this->_attributes[key]) = true;
+        this->set_attribute_value<ValueType>(this->attribute_slot(key), value);
     }
 
     /**
      * Returns a read-only reference to the given attribute.
      */
+    template<typename ValueType>
+    inline const ValueType &get_attribute_value(std::size_t slot) const
+    {
+        return (*utils::value_cast<ValueType>(&this->_values[slot]));
+    }
+
     template<typename ValueType>
     inline const ValueType &get_attribute_value(const std::string &key) const
     {
-        return (*std::any_cast<ValueType>(&std::get<0>(this->_attributes.at(key))));
+        return this->get_attribute_value<ValueType>(this->attribute_slot(key));
     }
 
     /**
      * Returns a read-write reference to the given attribute.
      * For model building from query data only.
      */
-    inline std::any &get_attribute(const std::string &key)
+    inline value_t &get_attribute(const std::string &key)
     {
-        return std::get<0>(this->_attributes[key]);
+        return this->_values[this->attribute_slot(key)];
     }
 
+    /**
+     * Builds the schema of a model type by constructing a prototype.
+     * Used by MODEL_DECL(), the primary key always has slot 0.
+     */
+    static ModelSchema build_schema(const std::type_info &type, std::string_view table_name, void (*prototype)());
+
+    /**
+     * Attaches the schema of the model type to a new model instance before
+     * the constructor of the model runs. Used by MODEL_DECL().
+     */
+    static void bind_schema(Model *model, const std::type_info &type, const ModelSchema &(*schema)());
+
     /**
      * Marks the model as unchanged again once the data has been loaded from the database.
      */
-    void reset_changed_state();
+    inline void reset_changed_state()
+    { this->_changed.clear(); }
 
 protected:
     Model();
@@ -246,10 +403,13 @@ protected:
      */
     virtual bool remove(Database *db);
 
-    // make model copy protected
-    // actual subclassed models have public copy
+    // make model copy and move protected
+    // actual subclassed models have public copy and move,
+    // moved-from models may only be assigned to or destroyed
     Model(const Model &other) = default;
     Model &operator= (const Model &other) = default;
+    Model(Model &&other) = default;
+    Model &operator= (Model &&other) = default;
 
     /**
      * Helper function to compare model attributes.
@@ -262,10 +422,44 @@ protected:
 
 private:
     friend class Database;
+    friend class WriteBuffer;
+
+    // slot of the primary key
+    static constexpr std::size_t id_slot = 0;
+
+    // model attributes indexed by schema slot
+    const ModelSchema *_schema = nullptr;
+    std::pmr::vector<value_t> _values{allocation_resource()};
+
+    // modified attributes and attributes skipped by a column projection
+    SlotBitset _changed;
+    SlotBitset _unloaded;
+
+    // the instance recording its attributes while the schema is built
+    static inline thread_local const Model *_schema_prototype = nullptr;
+    static inline thread_local bool _schema_slots_used = false;
+
+    // resource of the innermost AllocationScope on this thread
+    static inline thread_local std::pmr::memory_resource *_resource = nullptr;
+
+    static inline std::pmr::memory_resource *allocation_resource()
+    { return _resource ? _resource : std::pmr::get_default_resource(); }
+
+    void record_model_attribute(std::string_view name, value_t &&value, const utils::ValueCodec &codec, const std::type_index &column_type, bool nullable);
+    void erase_model_attribute(std::string_view name);
 
-    // model attribute map
-    std::map<key_t, attribute_t> _attributes;
-    std::list<key_t> _columns;
+    inline const value_t &attribute(std::size_t slot) const
+    { return this->_values[slot]; }
+
+    // converts the attribute for binding using the codec of its declared type
+    inline QVariant attribute_qvariant(std::size_t slot) const
+    { return this->_schema->codec(slot).to_qvariant(this->_values[slot], nullptr); }
+
+    // columns except the PK in slot order
+    const std::list<key_t> attribute_columns() const;
+
+    // slots of the given columns
+    const std::vector<std::size_t> attribute_slots(const std::list<key_t> &columns) const;
 
     /**
      * Constructs a model directly from a database query result.
@@ -273,11 +467,29 @@ private:
     Model(const Query *query, const Database *db);
 
     // prepared query generators for save()
-    const std::string generate_insert_query() const;
-    const std::string generate_update_query() const;
+    const std::string generate_update_query(const std::list<key_t> &columns) const;
+
+    // multi-row statements with positional placeholders for Database::saveRecords() and upsertRecords()
+    const std::string generate_batch_insert_query(std::size_t rows) const;
+    const std::string generate_batch_update_query(const std::list<key_t> &columns, std::size_t rows) const;
+    const std::string generate_upsert_query(const std::list<key_t> &changed_columns, bool with_id, std::size_t rows) const;
+
+    // changed attributes except the PK in column order
+    inline const std::list<key_t> changed_columns() const
+    { return this->changed_fields(); }
+
+    // attributes skipped by a column projection in column order
+    const std::list<key_t> unloaded_columns() const;
+
+    // refuse to write all columns of a partially loaded model
+    bool check_fully_loaded(const Database *db) const;
 
     // check if the model has any attributes other than the PK
     bool has_model_attributes() const;
+
+    // copies the changed attributes of the other model of the same type
+    // and marks them as changed, used to coalesce buffered saves
+    void merge_changes(const Model &other);
 };
 
 MODEL_STRING_FMT(Model);
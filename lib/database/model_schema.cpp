@@ -0,0 +1,132 @@
+#include "model_schema.hpp"
+
+#include <stdexcept>
+#include <cstdint>
+
+#include <QDateTime>
+
+#include <fmt/format.h>
+
+#include <utils/list.hpp>
+
+// MariaDB column types of the attribute types known to the QVariant converters,
+// schemas may be built during static initialization of other translation units
+static const std::unordered_map<std::type_index, std::string> &sql_types()
+{
+    static const std::unordered_map<std::type_index, std::string> sql_types {
+        {std::type_index(typeid(bool)), "boolean"},
+        {std::type_index(typeid(float)), "float"},
+        {std::type_index(typeid(double)), "double"},
+        {std::type_index(typeid(std::uint8_t)), "tinyint unsigned"},
+        {std::type_index(typeid(std::uint16_t)), "smallint unsigned"},
+        {std::type_index(typeid(std::uint32_t)), "int unsigned"},
+        {std::type_index(typeid(std::uint64_t)), "bigint unsigned"},
+        {std::type_index(typeid(std::int8_t)), "tinyint"},
+        {std::type_index(typeid(std::int16_t)), "smallint"},
+        {std::type_index(typeid(std::int32_t)), "int"},
+        {std::type_index(typeid(std::int64_t)), "bigint"},
+        {std::type_index(typeid(std::string)), "mediumtext"},
+        {std::type_index(typeid(QDateTime)), "datetime"},
+        {std::type_index(typeid(QDate)), "date"},
+        {std::type_index(typeid(QTime)), "time"},
+    };
+    return sql_types;
+}
+
+std::size_t ModelSchema::find(std::string_view column) const
+{
+    const auto it = this->_slots.find(column);
+    return it != this->_slots.cend() ? it->second : npos;
+}
+
+std::size_t ModelSchema::slot(std::string_view column) const
+{
+    const auto slot = this->find(column);
+    if (slot == npos)
+    {
+        throw std::out_of_range(fmt::format("model has no attribute {}", column));
+    }
+    return slot;
+}
+
+const DatabaseTable ModelSchema::table(std::string *error_message) const
+{
+    std::list<DatabaseTable::Field> fields{DatabaseTable::idField()};
+    for (std::size_t slot = 1; slot < this->_columns.size(); ++slot)
+    {
+        if (this->_sql_types[slot].empty())
+        {
+            if (error_message)
+            {
+                (*error_message) = fmt::format("{}: no SQL type known for column {}", this->_table_name, this->_columns[slot]);
+            }
+            return DatabaseTable(this->_table_name);
+        }
+
+        fields.emplace_back(DatabaseTable::Field{
+            .name = this->_columns[slot],
+            .type = this->_sql_types[slot],
+            .nullable = this->_nullable[slot]});
+    }
+
+    return DatabaseTable(this->_table_name, fields);
+}
+
+void ModelSchema::add(std::string_view column, utils::Value &&value, const utils::ValueCodec &codec, const std::type_index &column_type, bool nullable)
+{
+    const auto it = sql_types().find(column_type);
+    auto sql_type = it != sql_types().cend() ? it->second : std::string{};
+
+    // adding an existing attribute again replaces it
+    if (const auto slot = this->find(column); slot != npos)
+    {
+        this->_types[slot] = std::type_index(utils::value_type(value));
+        this->_codecs[slot] = &codec;
+        this->_defaults[slot] = std::move(value);
+        this->_sql_types[slot] = std::move(sql_type);
+        this->_nullable[slot] = nullable;
+        return;
+    }
+
+    this->_slots.emplace(key_t{column}, this->_columns.size());
+    this->_columns.emplace_back(column);
+    this->_types.emplace_back(utils::value_type(value));
+    this->_codecs.emplace_back(&codec);
+    this->_defaults.emplace_back(std::move(value));
+    this->_sql_types.emplace_back(std::move(sql_type));
+    this->_nullable.emplace_back(nullable);
+}
+
+void ModelSchema::remove(std::string_view column)
+{
+    const auto slot = this->find(column);
+    if (slot == npos)
+    {
+        return;
+    }
+
+    this->_columns.erase(this->_columns.begin() + slot);
+    this->_defaults.erase(this->_defaults.begin() + slot);
+    this->_types.erase(this->_types.begin() + slot);
+    this->_codecs.erase(this->_codecs.begin() + slot);
+    this->_sql_types.erase(this->_sql_types.begin() + slot);
+    this->_nullable.erase(this->_nullable.begin() + slot);
+
+    // following slots move up by one
+    this->_slots.clear();
+    for (std::size_t i = 0; i < this->_columns.size(); ++i)
+    {
+        this->_slots.emplace(this->_columns[i], i);
+    }
+}
+
+void ModelSchema::generate_statements()
+{
+    // all columns except the id
+    const std::list<key_t> columns(std::next(this->_columns.begin()), this->_columns.end());
+
+    this->_insert_statement = fmt::format("INSERT INTO `{}` ({}) VALUES ({});",
+        this->_table_name, utils::list_join(columns, ","), ":" + utils::list_join(columns, ",:"));
+    this->_find_statement = fmt::format("SELECT * FROM `{}` WHERE id=:id;", this->_table_name);
+    this->_delete_statement = fmt::format("DELETE FROM `{}` WHERE id=:id;", this->_table_name);
+}
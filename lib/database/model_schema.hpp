@@ -0,0 +1,239 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <optional>
+#include <typeindex>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "table.hpp"
+
+#include <utils/value.hpp>
+#include <utils/value_codec.hpp>
+
+/**
+ * Column type of a model attribute, optional attributes are nullable columns.
+ */
+template<typename ValueType>
+struct ModelColumnTraits
+{
+    using type = ValueType;
+    static constexpr bool nullable = false;
+};
+
+template<typename ValueType>
+struct ModelColumnTraits<std::optional<ValueType>>
+{
+    using type = ValueType;
+    static constexpr bool nullable = true;
+};
+
+/**
+ * Bitset over the schema slots of a model instance.
+ * Models with up to 64 attributes don't allocate.
+ */
+class SlotBitset final
+{
+public:
+    /**
+     * Clears the bitset and makes room for the given amount of slots.
+     */
+    inline void resize(std::size_t size)
+    {
+        this->_inline = 0;
+        this->_words.assign(size > 64 ? (size + 63) / 64 : 0, 0);
+    }
+
+    inline bool test(std::size_t slot) const
+    { return (this->word(slot) >> (slot % 64)) & 1; }
+
+    inline void set(std::size_t slot)
+    { this->word(slot) |= std::uint64_t{1} << (slot % 64); }
+
+    inline void reset(std::size_t slot)
+    { this->word(slot) &= ~(std::uint64_t{1} << (slot % 64)); }
+
+    /**
+     * Checks if any slot is set.
+     */
+    inline bool any() const
+    {
+        if (this->_words.empty()) return this->_inline != 0;
+        for (auto&& word : this->_words) if (word != 0) return true;
+        return false;
+    }
+
+    /**
+     * Resets all slots.
+     */
+    inline void clear()
+    {
+        this->_inline = 0;
+        std::fill(this->_words.begin(), this->_words.end(), 0);
+    }
+
+    /**
+     * Calls the function with every set slot in ascending order.
+     */
+    template<typename Function>
+    void for_each(Function &&function) const
+    {
+        const auto words = this->_words.empty() ? 1 : this->_words.size();
+        for (std::size_t i = 0; i < words; ++i)
+        {
+            auto word = this->_words.empty() ? this->_inline : this->_words[i];
+            while (word != 0)
+            {
+                function(i * 64 + static_cast<std::size_t>(std::countr_zero(word)));
+                word &= word - 1;
+            }
+        }
+    }
+
+private:
+    std::uint64_t _inline = 0;
+    std::vector<std::uint64_t> _words;
+
+    inline std::uint64_t &word(std::size_t slot)
+    { return this->_words.empty() ? this->_inline : this->_words[slot / 64]; }
+    inline std::uint64_t word(std::size_t slot) const
+    { return this->_words.empty() ? this->_inline : this->_words[slot / 64]; }
+};
+
+/**
+ * Attribute layout of a model type shared by all instances of the type.
+ * Every attribute has a fixed slot in the attribute storage of the model.
+ *
+ * The schema is built once per model type from a prototype instance,
+ * see MODEL_DECL() and Model::make_model_attribute(). It is immutable
+ * afterwards and also holds the generated statement text of the model.
+ */
+class ModelSchema final
+{
+public:
+    using key_t = std::string;
+
+    // slot returned by find() for unknown columns
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    /**
+     * All columns of the model in slot order.
+     */
+    constexpr inline const std::vector<key_t> &columns() const
+    { return this->_columns; }
+
+    /**
+     * Number of attributes of the model.
+     */
+    inline std::size_t size() const
+    { return this->_columns.size(); }
+
+    /**
+     * Returns the slot of the given column or npos.
+     */
+    std::size_t find(std::string_view column) const;
+
+    /**
+     * Returns the slot of the given column.
+     * Throws std::out_of_range if the model has no such column.
+     */
+    std::size_t slot(std::string_view column) const;
+
+    /**
+     * Checks if the model has the given column.
+     */
+    inline bool contains(std::string_view column) const
+    { return this->find(column) != npos; }
+
+    /**
+     * Column name of the given slot.
+     */
+    inline const key_t &column(std::size_t slot) const
+    { return this->_columns[slot]; }
+
+    /**
+     * Default value of the given slot as passed to make_model_attribute().
+     */
+    inline const utils::Value &default_value(std::size_t slot) const
+    { return this->_defaults[slot]; }
+
+    /**
+     * Conversion functions of the given slot, resolved from the declared attribute type.
+     */
+    inline const utils::ValueCodec &codec(std::size_t slot) const
+    { return *this->_codecs[slot]; }
+
+    /**
+     * C++ type of the given slot.
+     */
+    inline const std::type_index &type(std::size_t slot) const
+    { return this->_types[slot]; }
+
+    /**
+     * MariaDB column type of the given slot, empty for types without a known mapping.
+     */
+    inline const std::string &sql_type(std::size_t slot) const
+    { return this->_sql_types[slot]; }
+
+    /**
+     * Checks if the given slot holds an optional value.
+     */
+    inline bool nullable(std::size_t slot) const
+    { return this->_nullable[slot]; }
+
+    /**
+     * Table name of the model.
+     */
+    constexpr inline const std::string &table_name() const
+    { return this->_table_name; }
+
+    // generated statements
+    constexpr inline const std::string &insert_statement() const
+    { return this->_insert_statement; }
+    constexpr inline const std::string &find_statement() const
+    { return this->_find_statement; }
+    constexpr inline const std::string &delete_statement() const
+    { return this->_delete_statement; }
+
+    /**
+     * Generates the table definition of the model from the SQL type mapping.
+     * Returns an empty table when an attribute has no known SQL type.
+     */
+    const DatabaseTable table(std::string *error_message = nullptr) const;
+
+private:
+    friend class Model;
+
+    // transparent hash for lookups by std::string_view
+    struct KeyHash
+    {
+        using is_transparent = void;
+        inline std::size_t operator() (std::string_view key) const
+        { return std::hash<std::string_view>{}(key); }
+    };
+
+    std::string _table_name;
+
+    std::vector<key_t> _columns;
+    std::vector<utils::Value> _defaults;
+    std::vector<std::type_index> _types;
+    std::vector<const utils::ValueCodec*> _codecs;
+    std::vector<std::string> _sql_types;
+    std::vector<bool> _nullable;
+    std::unordered_map<key_t, std::size_t, KeyHash, std::equal_to<>> _slots;
+
+    std::string _insert_statement;
+    std::string _find_statement;
+    std::string _delete_statement;
+
+    // schema building from the prototype
+    void add(std::string_view column, utils::Value &&value, const utils::ValueCodec &codec, const std::type_index &column_type, bool nullable);
+    void remove(std::string_view column);
+    void generate_statements();
+};
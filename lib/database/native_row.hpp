@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+#include <QVariant>
+
+#include <utils/value.hpp>
+
+/**
+ * Current row of a result set read by a native database backend.
+ *
+ * Columns are decoded straight into the attribute storage of a model
+ * without the round trip through QVariant.
+ */
+class NativeRow
+{
+public:
+    virtual ~NativeRow() = default;
+
+    // column ordinal in the result set, -1 if the column is not present
+    virtual int index_of(const std::string &column) const = 0;
+
+    // decodes the given column into the value, the value keeps its type,
+    // missing columns are treated as NULL
+    virtual bool assign(int index, utils::Value &value) const = 0;
+
+    // converts the given column, used by models with custom constructors
+    virtual QVariant value(int index) const = 0;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "model.hpp"
+#include "executor.hpp"
+
+#include <list>
+#include <string>
+#include <future>
+#include <iterator>
+#include <cstddef>
+#include <functional>
+
+/**
+ * Input range over the pages of a model table using keyset pagination
+ * (id > last_id ORDER BY id LIMIT n). While the caller works on a page,
+ * the next page is already fetched on the executor using another connection.
+ *
+ * Usage: for (auto &page : db.pages<Project>(1000)) { for (auto &project : page) ... }
+ */
+template<typename ModelType>
+class ModelPager final
+{
+public:
+    using id_t = Model::id_t;
+    using page_t = std::list<ModelType>;
+
+    // fetches the page after the given id
+    using fetcher_t = std::function<std::future<DatabaseResult<page_t>>(id_t last_id)>;
+
+    class iterator final
+    {
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using value_type = page_t;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(ModelPager *pager)
+            : _pager(pager)
+        {}
+
+        inline page_t &operator* () const
+        { return this->_pager->_page; }
+        inline page_t *operator-> () const
+        { return &this->_pager->_page; }
+
+        inline iterator &operator++ ()
+        {
+            this->_pager->advance();
+            return *this;
+        }
+        inline void operator++ (int)
+        { ++(*this); }
+
+        inline bool operator== (std::default_sentinel_t) const
+        { return !this->_pager || this->_pager->_page.empty(); }
+
+    private:
+        ModelPager *_pager = nullptr;
+    };
+
+    ModelPager(std::size_t page_size, fetcher_t fetcher)
+        : _page_size(page_size),
+          _fetcher(std::move(fetcher))
+    {
+        // start fetching the first page right away
+        this->_next = this->_fetcher(0);
+    }
+
+    ModelPager(ModelPager &&other) = default;
+    ModelPager &operator= (ModelPager &&other) = default;
+
+    ~ModelPager()
+    {
+        // the prefetch must not outlive the pager
+        if (this->_next.valid()) this->_next.wait();
+    }
+
+    /**
+     * Fetches the first page on the first call. Can only be iterated once.
+     */
+    iterator begin()
+    {
+        if (!this->_started)
+        {
+            this->_started = true;
+            this->advance();
+        }
+        return iterator{this};
+    }
+
+    inline std::default_sentinel_t end() const
+    { return {}; }
+
+    /**
+     * Checks if fetching a page failed, iteration stops on errors.
+     */
+    constexpr inline bool error() const
+    { return this->_error; }
+
+    constexpr inline const std::string &errorMessage() const
+    { return this->_errorMessage; }
+
+private:
+    ModelPager(const ModelPager &other) = delete;
+    ModelPager &operator= (const ModelPager &other) = delete;
+
+    std::size_t _page_size;
+    fetcher_t _fetcher;
+    std::future<DatabaseResult<page_t>> _next;
+    page_t _page;
+    bool _started = false;
+    bool _error = false;
+    std::string _errorMessage;
+
+    void advance()
+    {
+        this->_page.clear();
+        if (!this->_next.valid())
+        {
+            return;
+        }
+
+        auto result = this->_next.get();
+        if (result.error)
+        {
+            this->_error = true;
+            this->_errorMessage = std::move(result.errorMessage);
+            return;
+        }
+
+        this->_page = std::move(result.value);
+
+        // a full page means there may be more records, prefetch the next one
+        if (this->_page.size() >= this->_page_size && !this->_page.empty())
+        {
+            this->_next = this->_fetcher(this->_page.back().id());
+        }
+    }
+};
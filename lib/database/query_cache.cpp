@@ -0,0 +1,203 @@
+#include "query_cache.hpp"
+
+#include <cctype>
+#include <algorithm>
+
+void QueryCache::configure(const std::type_index &type, std::size_t capacity, std::chrono::milliseconds ttl)
+{
+    const std::lock_guard lock{this->_mutex};
+    auto [it, inserted] = this->_tables.try_emplace(type);
+    it->second = Table{std::max<std::size_t>(capacity, 1), ttl, {}, {}};
+
+    // writes are not tracked while the cache is inactive, queries which
+    // started before must not be cached
+    ++this->_epoch;
+
+    if (inserted)
+    {
+        ++this->_types;
+    }
+}
+
+void QueryCache::remove(const std::type_index &type)
+{
+    const std::lock_guard lock{this->_mutex};
+    if (this->_tables.erase(type) > 0)
+    {
+        --this->_types;
+    }
+}
+
+std::shared_ptr<const void> QueryCache::find(const std::type_index &type, const std::string &table, const std::string &filter, std::uint64_t &generation)
+{
+    generation = 0;
+    if (!this->active())
+    {
+        return nullptr;
+    }
+
+    const std::lock_guard lock{this->_mutex};
+    generation = this->generation(table);
+
+    const auto cached = this->_tables.find(type);
+    if (cached == this->_tables.end())
+    {
+        return nullptr;
+    }
+
+    auto &t = cached->second;
+    const auto it = t.index.find(filter);
+    if (it == t.index.end())
+    {
+        ++this->_stats.misses;
+        return nullptr;
+    }
+
+    const auto &entry = *it->second;
+    if (entry.generation != generation || (t.ttl != clock::duration::zero() && clock::now() >= entry.expires))
+    {
+        ++(entry.generation != generation ? this->_stats.invalidations : this->_stats.expirations);
+        ++this->_stats.misses;
+        t.entries.erase(it->second);
+        t.index.erase(it);
+        return nullptr;
+    }
+
+    // move to the front of the LRU list
+    t.entries.splice(t.entries.begin(), t.entries, it->second);
+    ++this->_stats.hits;
+    return entry.result;
+}
+
+void QueryCache::insert(const std::type_index &type, const std::string &table, const std::string &filter,
+                        std::shared_ptr<const void> result, std::uint64_t generation)
+{
+    if (!this->active())
+    {
+        return;
+    }
+
+    const std::lock_guard lock{this->_mutex};
+
+    // the table was written while the query was running
+    if (this->generation(table) != generation)
+    {
+        return;
+    }
+
+    const auto cached = this->_tables.find(type);
+    if (cached == this->_tables.end())
+    {
+        return;
+    }
+
+    auto &t = cached->second;
+    const auto expires = clock::now() + t.ttl;
+    if (const auto it = t.index.find(filter); it != t.index.end())
+    {
+        *it->second = Entry{filter, std::move(result), generation, expires};
+        t.entries.splice(t.entries.begin(), t.entries, it->second);
+        return;
+    }
+
+    if (t.index.size() >= t.capacity)
+    {
+        t.index.erase(t.entries.back().filter);
+        t.entries.pop_back();
+        ++this->_stats.evictions;
+    }
+
+    t.entries.push_front(Entry{filter, std::move(result), generation, expires});
+    t.index.emplace(filter, t.entries.begin());
+}
+
+void QueryCache::invalidate(const std::string &table)
+{
+    if (!this->active())
+    {
+        return;
+    }
+
+    // stale entries are dropped on lookup or evicted
+    const std::lock_guard lock{this->_mutex};
+    ++this->_generations[table];
+}
+
+void QueryCache::invalidate()
+{
+    if (!this->active())
+    {
+        return;
+    }
+
+    const std::lock_guard lock{this->_mutex};
+    ++this->_epoch;
+}
+
+void QueryCache::clear()
+{
+    const std::lock_guard lock{this->_mutex};
+    ++this->_epoch;
+
+    for (auto&& [type, table] : this->_tables)
+    {
+        table.entries.clear();
+        table.index.clear();
+    }
+}
+
+QueryCacheStats QueryCache::stats() const
+{
+    const std::lock_guard lock{this->_mutex};
+    return this->_stats;
+}
+
+std::string QueryCache::normalize(const std::string &filter)
+{
+    std::string normalized;
+    normalized.reserve(filter.size());
+
+    char quote = 0;
+    bool space = false;
+    for (std::size_t i = 0; i < filter.size(); ++i)
+    {
+        const auto c = filter[i];
+        if (quote)
+        {
+            normalized += c;
+            if (c == '\\' && i + 1 < filter.size())
+            {
+                normalized += filter[++i];
+            }
+            else if (c == quote)
+            {
+                quote = 0;
+            }
+            continue;
+        }
+
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            space = !normalized.empty();
+            continue;
+        }
+
+        if (space)
+        {
+            normalized += ' ';
+            space = false;
+        }
+
+        if (c == '\'' || c == '"' || c == '`')
+        {
+            quote = c;
+        }
+        normalized += c;
+    }
+
+    while (!normalized.empty() && (normalized.back() == ';' || normalized.back() == ' '))
+    {
+        normalized.pop_back();
+    }
+    return normalized;
+}
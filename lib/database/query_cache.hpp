@@ -0,0 +1,131 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <typeindex>
+#include <unordered_map>
+
+/**
+ * Hit, miss and eviction counters of the query cache.
+ */
+struct QueryCacheStats final
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0; // entries dropped because the capacity was reached
+    std::uint64_t expirations = 0; // entries dropped because the TTL elapsed
+    std::uint64_t invalidations = 0; // entries dropped because their table was written
+};
+
+/**
+ * Cache of filtered result sets, see Database::enableQueryCache().
+ *
+ * Entries are keyed by model type and normalized filter and hold immutable
+ * result snapshots which are shared with the callers. Every table has a
+ * generation counter which is incremented on writes, entries stamped with
+ * an older generation of their table are stale and dropped on lookup.
+ * Every cached type evicts its least recently used entries when the
+ * capacity of the type is reached.
+ */
+class QueryCache final
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    QueryCache() = default;
+
+    /**
+     * Enables caching for the given model type. Capacity is the maximum amount
+     * of cached result sets of the type. A TTL of zero keeps entries until they
+     * are evicted or invalidated. Reconfiguring a type drops its entries.
+     */
+    void configure(const std::type_index &type, std::size_t capacity, std::chrono::milliseconds ttl);
+
+    /**
+     * Disables caching for the given model type and drops its entries.
+     */
+    void remove(const std::type_index &type);
+
+    /**
+     * Checks if any model type is cached.
+     */
+    inline bool active() const
+    { return this->_types.load(std::memory_order_relaxed) > 0; }
+
+    /**
+     * Returns the cached result set or nullptr. The current generation of the
+     * table is returned and must be passed to insert(), results of a query
+     * which raced with a write are never cached.
+     */
+    std::shared_ptr<const void> find(const std::type_index &type, const std::string &table, const std::string &filter, std::uint64_t &generation);
+
+    /**
+     * Caches the result set if its type is cached and the table
+     * wasn't written since the given generation.
+     */
+    void insert(const std::type_index &type, const std::string &table, const std::string &filter,
+                std::shared_ptr<const void> result, std::uint64_t generation);
+
+    /**
+     * Increments the generation of the given table or of all tables.
+     */
+    void invalidate(const std::string &table);
+    void invalidate();
+
+    /**
+     * Drops all entries.
+     */
+    void clear();
+
+    /**
+     * Returns the counters of the cache.
+     */
+    QueryCacheStats stats() const;
+
+    /**
+     * Normalizes the whitespace of a filter outside of quoted strings, so
+     * that equivalent filters with different formatting share an entry.
+     */
+    static std::string normalize(const std::string &filter);
+
+private:
+    QueryCache(const QueryCache &other) = delete;
+    QueryCache &operator= (const QueryCache &other) = delete;
+
+    struct Entry
+    {
+        std::string filter;
+        std::shared_ptr<const void> result;
+        std::uint64_t generation;
+        clock::time_point expires;
+    };
+
+    // result sets of one model type
+    struct Table
+    {
+        std::size_t capacity = 0;
+        clock::duration ttl{};
+        std::list<Entry> entries; // most recently used first
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    };
+
+    mutable std::mutex _mutex;
+    std::unordered_map<std::type_index, Table> _tables;
+    std::unordered_map<std::string, std::uint64_t> _generations;
+    std::uint64_t _epoch = 0; // incremented when all tables are invalidated
+    QueryCacheStats _stats;
+    std::atomic<std::size_t> _types{0};
+
+    // both counters only grow, so their sum changes whenever one of them does
+    inline std::uint64_t generation(const std::string &table) const
+    {
+        const auto it = this->_generations.find(table);
+        return this->_epoch + (it == this->_generations.end() ? 0 : it->second);
+    }
+};
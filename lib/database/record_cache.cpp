@@ -0,0 +1,212 @@
+#include "record_cache.hpp"
+
+#include <algorithm>
+
+RecordCache::Shard &RecordCache::shard(const std::type_index &type, id_t id)
+{
+    // the upper bits of the mixed hash select the shard
+    const std::uint64_t hash = (static_cast<std::uint64_t>(id) ^ type.hash_code()) * 0x9E3779B97F4A7C15ull;
+    return this->_shards[hash >> 60];
+}
+
+void RecordCache::configure(const std::type_index &type, std::size_t capacity, std::chrono::milliseconds ttl, copy_t copy)
+{
+    // the capacity is split evenly over the shards
+    const auto shard_capacity = std::max<std::size_t>((capacity + shard_count - 1) / shard_count, 1);
+
+    const std::lock_guard configuring{this->_configure_mutex};
+
+    bool added = false;
+    for (auto&& shard : this->_shards)
+    {
+        const std::lock_guard lock{shard.mutex};
+        auto [it, inserted] = shard.tables.try_emplace(type);
+        it->second = Table{shard_capacity, ttl, copy, {}, {}};
+        ++shard.version;
+        added |= inserted;
+    }
+
+    if (added)
+    {
+        ++this->_types;
+    }
+}
+
+void RecordCache::remove(const std::type_index &type)
+{
+    const std::lock_guard configuring{this->_configure_mutex};
+
+    bool removed = false;
+    for (auto&& shard : this->_shards)
+    {
+        const std::lock_guard lock{shard.mutex};
+        removed |= shard.tables.erase(type) > 0;
+        ++shard.version;
+    }
+
+    if (removed)
+    {
+        --this->_types;
+    }
+}
+
+std::shared_ptr<const Model> RecordCache::find(const std::type_index &type, id_t id, std::uint64_t &token)
+{
+    token = 0;
+    if (!this->active())
+    {
+        return nullptr;
+    }
+
+    auto &shard = this->shard(type, id);
+    const std::lock_guard lock{shard.mutex};
+    token = shard.version;
+
+    const auto table = shard.tables.find(type);
+    if (table == shard.tables.end())
+    {
+        return nullptr;
+    }
+
+    const auto it = table->second.index.find(id);
+    if (it == table->second.index.end())
+    {
+        ++shard.stats.misses;
+        return nullptr;
+    }
+
+    if (table->second.ttl != clock::duration::zero() && clock::now() >= it->second->expires)
+    {
+        table->second.entries.erase(it->second);
+        table->second.index.erase(it);
+        ++shard.stats.expirations;
+        ++shard.stats.misses;
+        return nullptr;
+    }
+
+    // move to the front of the LRU list
+    table->second.entries.splice(table->second.entries.begin(), table->second.entries, it->second);
+    ++shard.stats.hits;
+    return it->second->model;
+}
+
+void RecordCache::insert(const std::type_index &type, id_t id, const Model &model, std::uint64_t token)
+{
+    if (!this->active())
+    {
+        return;
+    }
+
+    auto &shard = this->shard(type, id);
+    const std::lock_guard lock{shard.mutex};
+
+    // the record may be outdated already when it was invalidated after the lookup
+    if (shard.version != token)
+    {
+        return;
+    }
+
+    const auto table = shard.tables.find(type);
+    if (table == shard.tables.end())
+    {
+        return;
+    }
+
+    auto &t = table->second;
+    const auto expires = clock::now() + t.ttl;
+    if (const auto it = t.index.find(id); it != t.index.end())
+    {
+        it->second->model = t.copy(model);
+        it->second->expires = expires;
+        t.entries.splice(t.entries.begin(), t.entries, it->second);
+        return;
+    }
+
+    if (t.index.size() >= t.capacity)
+    {
+        t.index.erase(t.entries.back().id);
+        t.entries.pop_back();
+        ++shard.stats.evictions;
+    }
+
+    t.entries.push_front(Entry{id, t.copy(model), expires});
+    t.index.emplace(id, t.entries.begin());
+}
+
+void RecordCache::erase(const std::type_index &type, id_t id)
+{
+    if (!this->active())
+    {
+        return;
+    }
+
+    auto &shard = this->shard(type, id);
+    const std::lock_guard lock{shard.mutex};
+    ++shard.version;
+
+    const auto table = shard.tables.find(type);
+    if (table == shard.tables.end())
+    {
+        return;
+    }
+
+    if (const auto it = table->second.index.find(id); it != table->second.index.end())
+    {
+        table->second.entries.erase(it->second);
+        table->second.index.erase(it);
+    }
+}
+
+void RecordCache::erase(const std::type_index &type)
+{
+    if (!this->active())
+    {
+        return;
+    }
+
+    for (auto&& shard : this->_shards)
+    {
+        const std::lock_guard lock{shard.mutex};
+        ++shard.version;
+
+        if (const auto table = shard.tables.find(type); table != shard.tables.end())
+        {
+            table->second.entries.clear();
+            table->second.index.clear();
+        }
+    }
+}
+
+void RecordCache::clear()
+{
+    if (!this->active())
+    {
+        return;
+    }
+
+    for (auto&& shard : this->_shards)
+    {
+        const std::lock_guard lock{shard.mutex};
+        ++shard.version;
+
+        for (auto&& [type, table] : shard.tables)
+        {
+            table.entries.clear();
+            table.index.clear();
+        }
+    }
+}
+
+RecordCacheStats RecordCache::stats() const
+{
+    RecordCacheStats stats;
+    for (auto&& shard : this->_shards)
+    {
+        const std::lock_guard lock{shard.mutex};
+        stats.hits += shard.stats.hits;
+        stats.misses += shard.stats.misses;
+        stats.evictions += shard.stats.evictions;
+        stats.expirations += shard.stats.expirations;
+    }
+    return stats;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "model.hpp"
+
+#include <list>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <typeindex>
+#include <unordered_map>
+
+/**
+ * Hit, miss and eviction counters of the record cache.
+ */
+struct RecordCacheStats final
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0; // entries dropped because the capacity was reached
+    std::uint64_t expirations = 0; // entries dropped because the TTL elapsed
+};
+
+/**
+ * Identity map of records found by id, see Database::enableRecordCache().
+ *
+ * Only model types which were configured are cached. Entries are immutable
+ * copies of the loaded models, keyed by model type and id and spread over
+ * independently locked shards. Every shard evicts the least recently used
+ * entries of a type when the capacity of the type is reached.
+ */
+class RecordCache final
+{
+public:
+    using id_t = Model::id_t;
+    using clock = std::chrono::steady_clock;
+    using copy_t = std::shared_ptr<const Model>(*)(const Model &model);
+
+    RecordCache() = default;
+
+    /**
+     * Enables caching for the given model type. A TTL of zero keeps entries
+     * until they are evicted or invalidated. Reconfiguring a type drops its entries.
+     */
+    void configure(const std::type_index &type, std::size_t capacity, std::chrono::milliseconds ttl, copy_t copy);
+
+    /**
+     * Disables caching for the given model type and drops its entries.
+     */
+    void remove(const std::type_index &type);
+
+    /**
+     * Checks if any model type is cached.
+     */
+    inline bool active() const
+    { return this->_types.load(std::memory_order_relaxed) > 0; }
+
+    /**
+     * Returns the cached record or nullptr. On a miss the token must be
+     * passed to insert(), which drops the record when it was invalidated
+     * in the meantime.
+     */
+    std::shared_ptr<const Model> find(const std::type_index &type, id_t id, std::uint64_t &token);
+
+    /**
+     * Caches a copy of the given model if its type is cached.
+     */
+    void insert(const std::type_index &type, id_t id, const Model &model, std::uint64_t token);
+
+    /**
+     * Drops the given record or all records of the given type.
+     */
+    void erase(const std::type_index &type, id_t id);
+    void erase(const std::type_index &type);
+
+    /**
+     * Drops all records.
+     */
+    void clear();
+
+    /**
+     * Returns the counters summed up over all shards.
+     */
+    RecordCacheStats stats() const;
+
+private:
+    RecordCache(const RecordCache &other) = delete;
+    RecordCache &operator= (const RecordCache &other) = delete;
+
+    static constexpr std::size_t shard_count = 16;
+
+    struct Entry
+    {
+        id_t id;
+        std::shared_ptr<const Model> model;
+        clock::time_point expires;
+    };
+
+    // records of one model type within a shard
+    struct Table
+    {
+        std::size_t capacity = 0;
+        clock::duration ttl{};
+        copy_t copy = nullptr;
+        std::list<Entry> entries; // most recently used first
+        std::unordered_map<id_t, std::list<Entry>::iterator> index;
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<std::type_index, Table> tables;
+        std::uint64_t version = 0; // incremented by every invalidation
+        RecordCacheStats stats;
+    };
+
+    std::array<Shard, shard_count> _shards;
+    std::atomic<std::size_t> _types{0};
+    std::mutex _configure_mutex; // configure() and remove() of the same type must not interleave
+
+    Shard &shard(const std::type_index &type, id_t id);
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <list>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <typeindex>
+#include <functional>
+#include <unordered_map>
+
+#include <QSqlQuery>
+
+// note: this header is for internal use only, it exposes QtSql
+
+/**
+ * Kind of a generated model statement.
+ */
+enum class StatementKind : std::uint8_t
+{
+    Insert,
+    Update,
+    FindById,
+    DeleteById,
+    Upsert,
+};
+
+/**
+ * Identifies a prepared statement by model type, operation and
+ * the affected columns (only relevant for updates and upserts).
+ */
+struct StatementKey final
+{
+    std::type_index type;
+    StatementKind kind;
+    std::string columns;
+
+    inline bool operator== (const StatementKey &other) const
+    {
+        return type == other.type &&
+               kind == other.kind &&
+               columns == other.columns;
+    }
+};
+
+struct StatementKeyHash final
+{
+    inline std::size_t operator() (const StatementKey &key) const
+    {
+        auto hash = std::hash<std::type_index>{}(key.type);
+        hash ^= std::hash<std::uint8_t>{}(static_cast<std::uint8_t>(key.kind)) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        hash ^= std::hash<std::string>{}(key.columns) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+};
+
+/**
+ * Prepared statements of a single connection. A statement which is
+ * still referenced outside of the cache is considered busy.
+ *
+ * Update statements are cached per set of changed columns, so the cache
+ * is limited and evicts the least recently used statements to stay below
+ * the server limit of prepared statements (max_prepared_stmt_count).
+ * Evicted busy statements stay alive until their last user releases them.
+ */
+class StatementCache final
+{
+public:
+    explicit StatementCache(std::size_t capacity = 256)
+        : _capacity(std::max<std::size_t>(capacity, 1))
+    {}
+
+    /**
+     * Returns the cached statement and marks it as most recently used,
+     * nullptr when the statement isn't cached.
+     */
+    const std::shared_ptr<QSqlQuery> *find(const StatementKey &key)
+    {
+        const auto it = this->_index.find(key);
+        if (it == this->_index.end())
+        {
+            return nullptr;
+        }
+
+        this->_entries.splice(this->_entries.begin(), this->_entries, it->second);
+        return &it->second->second;
+    }
+
+    /**
+     * Caches the statement, evicts the least recently used statement when full.
+     */
+    void insert(const StatementKey &key, std::shared_ptr<QSqlQuery> statement)
+    {
+        if (this->_index.contains(key))
+        {
+            return;
+        }
+
+        if (this->_entries.size() >= this->_capacity)
+        {
+            this->_index.erase(this->_entries.back().first);
+            this->_entries.pop_back();
+        }
+
+        this->_entries.emplace_front(key, std::move(statement));
+        this->_index.emplace(key, this->_entries.begin());
+    }
+
+    inline std::size_t size() const
+    { return this->_entries.size(); }
+
+    inline void clear()
+    {
+        this->_index.clear();
+        this->_entries.clear();
+    }
+
+private:
+    using entry_t = std::pair<StatementKey, std::shared_ptr<QSqlQuery>>;
+
+    std::size_t _capacity;
+    std::list<entry_t> _entries; // most recently used first
+    std::unordered_map<StatementKey, std::list<entry_t>::iterator, StatementKeyHash> _index;
+};
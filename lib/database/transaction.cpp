@@ -0,0 +1,53 @@
+#include "transaction.hpp"
+#include "database.hpp"
+
+Transaction::Transaction(Database &db)
+    : _db(db)
+{
+    this->_active = this->_db.beginTransaction();
+}
+
+Transaction::~Transaction()
+{
+    if (this->_active)
+    {
+        this->_db.rollbackTransaction();
+    }
+}
+
+bool Transaction::commit()
+{
+    if (!this->_active)
+    {
+        return false;
+    }
+
+    this->_active = false;
+    return this->_db.commitTransaction();
+}
+
+bool Transaction::rollback()
+{
+    if (!this->_active)
+    {
+        return false;
+    }
+
+    this->_active = false;
+    return this->_db.rollbackTransaction();
+}
+
+bool Transaction::saveRecord(Model *model)
+{
+    return this->_db.saveRecord(model);
+}
+
+bool Transaction::upsertRecord(Model *model)
+{
+    return this->_db.upsertRecord(model);
+}
+
+bool Transaction::deleteRecord(Model *model)
+{
+    return this->_db.deleteRecord(model);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+class Database;
+class Model;
+
+/**
+ * Scoped database transaction.
+ *
+ * All database operations of the calling thread run on the same
+ * connection inside the transaction until it is committed or rolled
+ * back. The transaction is rolled back automatically when it goes out
+ * of scope without being committed, including stack unwinding.
+ *
+ * Nested transactions on the same thread join the outer transaction.
+ * Rolling back a nested transaction makes the outer commit fail.
+ *
+ * Asynchronous operations run on other threads and are not part of
+ * the transaction.
+ */
+class Transaction final
+{
+public:
+    /**
+     * Begins a new transaction. Check active() to see if it succeeded.
+     */
+    explicit Transaction(Database &db);
+
+    /**
+     * Rolls back the transaction if it is still active.
+     */
+    ~Transaction();
+
+    /**
+     * Checks if the transaction was started and not yet committed or rolled back.
+     */
+    constexpr inline bool active() const
+    { return this->_active; }
+
+    /**
+     * Commits the transaction.
+     */
+    bool commit();
+
+    /**
+     * Rolls back the transaction.
+     */
+    bool rollback();
+
+    /**
+     * Returns the database the transaction belongs to.
+     */
+    constexpr inline Database &database() const
+    { return this->_db; }
+
+    // convenience forwarders to the database
+    bool saveRecord(Model *model);
+    bool upsertRecord(Model *model);
+    bool deleteRecord(Model *model);
+
+private:
+    Transaction(const Transaction &other) = delete;
+    Transaction &operator= (const Transaction &other) = delete;
+
+    Database &_db;
+    bool _active = false;
+};
@@ -0,0 +1,199 @@
+#include "write_buffer.hpp"
+
+#include <algorithm>
+
+#include <fmt/format.h>
+
+WriteBuffer::WriteBuffer(std::chrono::milliseconds interval, std::size_t batch_size, write_t write)
+    : _interval(std::max(interval, std::chrono::milliseconds(1))),
+      _batch_size(std::max<std::size_t>(batch_size, 1)),
+      _write(std::move(write))
+{
+}
+
+WriteBuffer::~WriteBuffer()
+{
+    {
+        const std::lock_guard lock{this->_mutex};
+        this->_stopping = true;
+    }
+    this->_wakeup.notify_all();
+
+    // the flusher writes the remaining saves before it exits
+    if (this->_flusher.joinable())
+    {
+        this->_flusher.join();
+    }
+}
+
+void WriteBuffer::configure(const std::type_index &type, copy_t copy)
+{
+    const std::lock_guard lock{this->_mutex};
+    if (this->_types.insert_or_assign(type, copy).second)
+    {
+        ++this->_types_count;
+    }
+}
+
+void WriteBuffer::remove(const std::type_index &type)
+{
+    const std::lock_guard lock{this->_mutex};
+    if (this->_types.erase(type) > 0)
+    {
+        --this->_types_count;
+    }
+}
+
+bool WriteBuffer::add(const Model &model)
+{
+    std::unique_lock lock{this->_mutex};
+
+    const auto type = this->_types.find(typeid(model));
+    if (type == this->_types.end() || this->_stopping)
+    {
+        return false;
+    }
+
+    const key_t key{typeid(model), model.id()};
+    if (const auto it = this->_pending.find(key); it != this->_pending.end())
+    {
+        it->second->merge_changes(model);
+    }
+    else
+    {
+        this->_pending.emplace(key, type->second(model));
+    }
+
+    // start the flusher on first use
+    if (!this->_flusher.joinable())
+    {
+        this->_flusher = std::thread(&WriteBuffer::run, this);
+    }
+
+    const auto full = this->_pending.size() >= this->_batch_size;
+    lock.unlock();
+    if (full)
+    {
+        this->_wakeup.notify_one();
+    }
+    return true;
+}
+
+std::vector<std::unique_ptr<Model>> WriteBuffer::take(const std::vector<Model*> &models)
+{
+    std::vector<std::unique_ptr<Model>> taken;
+    if (!this->active())
+    {
+        return taken;
+    }
+
+    // the running flush may still write older saves of the records,
+    // flushes of other records are not awaited
+    std::unique_lock lock{this->_mutex};
+    this->_written.wait(lock, [&]{
+        return std::none_of(models.begin(), models.end(), [&](const Model *model){
+            return this->_writing.contains({typeid(*model), model->id()}); });
+    });
+
+    for (auto&& model : models)
+    {
+        if (const auto it = this->_pending.find({typeid(*model), model->id()}); it != this->_pending.end())
+        {
+            taken.emplace_back(std::move(it->second));
+            this->_pending.erase(it);
+        }
+    }
+    return taken;
+}
+
+void WriteBuffer::restore(std::vector<std::unique_ptr<Model>> &&models)
+{
+    const std::lock_guard lock{this->_mutex};
+    for (auto&& model : models)
+    {
+        const key_t key{typeid(*model), model->id()};
+        const auto [it, inserted] = this->_pending.try_emplace(key, std::move(model));
+        if (!inserted)
+        {
+            model->merge_changes(*it->second);
+            it->second = std::move(model);
+        }
+    }
+}
+
+bool WriteBuffer::flush(std::string &error)
+{
+    const std::lock_guard flushing{this->_flush_mutex};
+
+    std::vector<std::unique_ptr<Model>> pending;
+    {
+        const std::lock_guard lock{this->_mutex};
+        pending.reserve(this->_pending.size());
+        for (auto&& [key, model] : this->_pending)
+        {
+            this->_writing.insert(key);
+            pending.emplace_back(std::move(model));
+        }
+        this->_pending.clear();
+    }
+
+    if (pending.empty())
+    {
+        return true;
+    }
+
+    std::vector<Model*> models;
+    models.reserve(pending.size());
+    for (auto&& model : pending)
+    {
+        models.emplace_back(model.get());
+    }
+
+    const auto status = this->_write(models, error);
+    if (!status)
+    {
+        this->restore(std::move(pending));
+    }
+
+    {
+        const std::lock_guard lock{this->_mutex};
+        this->_writing.clear();
+    }
+    this->_written.notify_all();
+    return status;
+}
+
+std::size_t WriteBuffer::size() const
+{
+    const std::lock_guard lock{this->_mutex};
+    return this->_pending.size();
+}
+
+void WriteBuffer::run()
+{
+    std::string error;
+    bool failed = false;
+
+    std::unique_lock lock{this->_mutex};
+    while (!this->_stopping)
+    {
+        // after a failure the full interval is awaited before retrying
+        this->_wakeup.wait_for(lock, this->_interval, [&]{
+            return this->_stopping || (!failed && this->_pending.size() >= this->_batch_size); });
+
+        lock.unlock();
+        failed = !this->flush(error);
+        if (failed)
+        {
+            fmt::print("write-behind flush failed, {} saves kept for retry: {}\n", this->size(), error);
+        }
+        lock.lock();
+    }
+    lock.unlock();
+
+    // final flush, new saves are no longer accepted
+    if (!this->flush(error))
+    {
+        fmt::print("write-behind flush failed, {} saves were lost: {}\n", this->size(), error);
+    }
+}
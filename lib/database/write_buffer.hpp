@@ -0,0 +1,112 @@
+#pragma once
+
+#include "model.hpp"
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstddef>
+#include <typeindex>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+/**
+ * Write-behind buffer for saves of existing records, see Database::enableWriteBehind().
+ *
+ * Saves are queued per model type and id, repeated saves of the same record
+ * are merged into one pending save holding the union of the changed attributes.
+ * A background thread writes the pending saves when the interval elapsed or
+ * the batch size was reached. The thread is started on the first buffered save
+ * and writes all remaining saves before it exits.
+ */
+class WriteBuffer final
+{
+public:
+    using copy_t = std::unique_ptr<Model>(*)(const Model &model);
+
+    // writes the given models, returns false and sets the error message on failure
+    using write_t = std::function<bool(const std::vector<Model*> &models, std::string &error)>;
+
+    WriteBuffer(std::chrono::milliseconds interval, std::size_t batch_size, write_t write);
+
+    /**
+     * Stops the background thread after all pending saves were written.
+     */
+    ~WriteBuffer();
+
+    /**
+     * Enables or disables buffering for the given model type.
+     * Pending saves of a disabled type are still written.
+     */
+    void configure(const std::type_index &type, copy_t copy);
+    void remove(const std::type_index &type);
+
+    /**
+     * Checks if any model type is buffered.
+     */
+    inline bool active() const
+    { return this->_types_count.load(std::memory_order_relaxed) > 0; }
+
+    /**
+     * Queues the changed attributes of the model, returns false when
+     * the model type isn't buffered.
+     */
+    bool add(const Model &model);
+
+    /**
+     * Removes and returns the pending saves of the given models, waits
+     * while a running flush writes any of them. Used to keep the order of
+     * writes when the records are written directly.
+     */
+    std::vector<std::unique_ptr<Model>> take(const std::vector<Model*> &models);
+
+    /**
+     * Queues saves again which couldn't be written, newer saves of the
+     * same records take precedence.
+     */
+    void restore(std::vector<std::unique_ptr<Model>> &&models);
+
+    /**
+     * Writes all pending saves. Failed saves are kept for the next flush.
+     */
+    bool flush(std::string &error);
+
+    /**
+     * Amount of pending saves.
+     */
+    std::size_t size() const;
+
+private:
+    WriteBuffer(const WriteBuffer &other) = delete;
+    WriteBuffer &operator= (const WriteBuffer &other) = delete;
+
+    using key_t = std::pair<std::type_index, Model::id_t>;
+
+    const std::chrono::milliseconds _interval;
+    const std::size_t _batch_size;
+    const write_t _write;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _wakeup;
+    std::unordered_map<std::type_index, copy_t> _types;
+    std::atomic<std::size_t> _types_count{0};
+    std::map<key_t, std::unique_ptr<Model>> _pending; // ordered by type and id, rows are locked in a stable order
+    std::thread _flusher;
+    bool _stopping = false;
+
+    // only one flush at a time, so older saves never overwrite newer ones
+    std::mutex _flush_mutex;
+
+    // records written by the running flush, take() waits for them
+    std::set<key_t> _writing;
+    std::condition_variable _written;
+
+    void run();
+};
@@ -0,0 +1,138 @@
+// Tests of the ColumnBuffer kernels of database/columns.hpp.
+
+#include <database/columns.hpp>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <cstdlib>
+#include <optional>
+
+#include <fmt/format.h>
+
+struct ColumnBufferTest final
+{
+    template<ColumnType T>
+    static ColumnBuffer<T> make(const std::vector<std::optional<T>> &values)
+    {
+        ColumnBuffer<T> buffer;
+        buffer.reserve(values.size());
+        for (auto value : values)
+        {
+            buffer.push_back(std::move(value));
+        }
+        return buffer;
+    }
+};
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition))                                                     \
+        {                                                                     \
+            fmt::print("{}:{}: check failed: {}\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                       \
+        }                                                                     \
+    } while (false)
+
+constexpr auto inf = std::numeric_limits<double>::infinity();
+constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+
+void test_integer_kernels()
+{
+    // more than one block of 64 values, some of them NULL
+    std::vector<std::optional<std::int32_t>> values;
+    std::int64_t sum = 0;
+    for (std::int32_t i = 0; i < 150; ++i)
+    {
+        if (i % 7 == 3)
+        {
+            values.emplace_back(std::nullopt);
+            continue;
+        }
+        const auto value = (i * 37) % 101 - 50;
+        values.emplace_back(value);
+        sum += value;
+    }
+
+    const auto column = ColumnBufferTest::make(values);
+    CHECK(column.size() == 150);
+    CHECK(column.null_count() == 21);
+    CHECK(column.sum() == sum);
+    CHECK(column.min() == -50);
+    CHECK(column.max() == 50);
+
+    const auto unsigned_column = ColumnBufferTest::make<std::uint64_t>({3, std::nullopt, 7});
+    CHECK(unsigned_column.min() == 3u);
+    CHECK(unsigned_column.max() == 7u);
+
+    const auto nulls = ColumnBufferTest::make<std::int64_t>({std::nullopt, std::nullopt});
+    CHECK(!nulls.min().has_value());
+    CHECK(!nulls.max().has_value());
+    CHECK(nulls.sum() == 0);
+}
+
+void test_floating_point_kernels()
+{
+    std::vector<std::optional<double>> values;
+    for (int i = 0; i < 130; ++i)
+    {
+        values.emplace_back(i % 5 == 0 ? std::nullopt : std::optional<double>{i * 0.5});
+    }
+    const auto column = ColumnBufferTest::make(values);
+    double sum = 0;
+    for (auto &&value : values)
+    {
+        sum += value.value_or(0);
+    }
+    CHECK(std::abs(column.sum() - sum) < 1e-9);
+    CHECK(column.min() == 0.5);
+    CHECK(column.max() == 64.5);
+}
+
+void test_infinities()
+{
+    const auto positive = ColumnBufferTest::make<double>({inf, std::nullopt, inf});
+    CHECK(positive.min() == inf);
+    CHECK(positive.max() == inf);
+
+    const auto negative = ColumnBufferTest::make<double>({-inf, -inf});
+    CHECK(negative.min() == -inf);
+    CHECK(negative.max() == -inf);
+
+    const auto mixed = ColumnBufferTest::make<float>({1.0f, -std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity()});
+    CHECK(mixed.min() == -std::numeric_limits<float>::infinity());
+    CHECK(mixed.max() == std::numeric_limits<float>::infinity());
+    CHECK(std::isnan(mixed.sum()));
+}
+
+void test_nan_is_ignored()
+{
+    // the result doesn't depend on the position of the NaN values
+    for (const auto &values : std::vector<std::vector<std::optional<double>>>{{nan, 1.0, 2.0}, {1.0, nan, 2.0}, {1.0, 2.0, nan}})
+    {
+        const auto column = ColumnBufferTest::make(values);
+        CHECK(column.min() == 1.0);
+        CHECK(column.max() == 2.0);
+    }
+}
+
+}
+
+int main()
+{
+    test_integer_kernels();
+    test_floating_point_kernels();
+    test_infinities();
+    test_nan_is_ignored();
+
+    if (failures > 0)
+    {
+        fmt::print("{} checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
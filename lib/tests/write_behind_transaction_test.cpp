@@ -0,0 +1,159 @@
+// Tests buffered saves of records which are written inside a transaction.
+//
+// Requires a MariaDB server, the connection is configured with the environment
+// variables AWESOMEDB_TEST_HOST, AWESOMEDB_TEST_USERNAME, AWESOMEDB_TEST_PASSWORD
+// and AWESOMEDB_TEST_DATABASE. The test is skipped when no host is given.
+// The table "awesomedb_test_counters" is created and dropped again.
+
+#include <database/database.hpp>
+#include <database/transaction.hpp>
+
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <cstdint>
+
+#include <fmt/format.h>
+
+MODEL(TestCounter)
+{
+    MODEL_DECL(TestCounter, "awesomedb_test_counters");
+    MODEL_ATTRIBUTE(hits, std::int64_t);
+};
+
+TestCounter::TestCounter()
+{
+    this->make_model_attribute<std::int64_t>("hits", 0);
+}
+
+TestCounter::TestCounter(const Query *query, const Database *db)
+    : TestCounter()
+{
+    this->construct_default(query);
+}
+
+MODEL_DEFAULT_VALID_IMPL(TestCounter);
+
+namespace {
+
+// return code which makes ctest report the test as skipped
+constexpr int skipped = 77;
+
+int failures = 0;
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition))                                                     \
+        {                                                                     \
+            fmt::print("{}:{}: check failed: {}\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                       \
+        }                                                                     \
+    } while (false)
+
+std::string environment(const char *name)
+{
+    const auto value = std::getenv(name);
+    return value ? value : "";
+}
+
+std::int64_t stored_hits(Database &db, TestCounter::id_t id)
+{
+    return db.findRecord<TestCounter>(id).hits();
+}
+
+// the transaction locks a row with a pending save and saves another record,
+// which has a pending save as well
+void test_save_while_holding_a_row_lock(Database &db, const std::string &table)
+{
+    TestCounter saved, locked;
+    CHECK(db.saveRecord(&saved));
+    CHECK(db.saveRecord(&locked));
+
+    db.enableWriteBehind<TestCounter>();
+    saved.set_hits(1);
+    CHECK(db.saveRecord(&saved));
+    locked.set_hits(1);
+    CHECK(db.saveRecord(&locked));
+    CHECK(db.pendingWrites() == 2);
+
+    const auto start = std::chrono::steady_clock::now();
+    CHECK(!db.transaction([&](Transaction &tx) {
+        CHECK(db.execute(fmt::format("UPDATE `{}` SET hits=hits WHERE id={};", table, locked.id())));
+
+        // the pending save of this record is written outside of the transaction,
+        // the pending save of the locked row isn't touched
+        saved.set_hits(2);
+        CHECK(tx.saveRecord(&saved));
+        CHECK(db.pendingWrites() == 1);
+        return false; // roll back
+    }));
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(10));
+
+    // the acknowledged buffered save survived the rollback
+    CHECK(stored_hits(db, saved.id()) == 1);
+
+    CHECK(db.flush());
+    CHECK(stored_hits(db, locked.id()) == 1);
+    db.disableWriteBehind<TestCounter>();
+}
+
+// a rolled back delete keeps the buffered save of the record
+void test_rolled_back_delete(Database &db)
+{
+    TestCounter counter;
+    CHECK(db.saveRecord(&counter));
+
+    db.enableWriteBehind<TestCounter>();
+    counter.set_hits(5);
+    CHECK(db.saveRecord(&counter));
+
+    auto deleted = counter;
+    CHECK(!db.transaction([&](Transaction &tx) {
+        CHECK(tx.deleteRecord(&deleted));
+        return false; // roll back
+    }));
+
+    CHECK(db.pendingWrites() == 0);
+    CHECK(stored_hits(db, counter.id()) == 5);
+    db.disableWriteBehind<TestCounter>();
+}
+
+}
+
+int main()
+{
+    DatabaseConfig config;
+    config.host = environment("AWESOMEDB_TEST_HOST");
+    config.username = environment("AWESOMEDB_TEST_USERNAME");
+    config.password = environment("AWESOMEDB_TEST_PASSWORD");
+    config.database = environment("AWESOMEDB_TEST_DATABASE");
+    if (config.host.empty())
+    {
+        fmt::print("AWESOMEDB_TEST_HOST isn't set, skipping\n");
+        return skipped;
+    }
+
+    // buffered saves stay pending until they are written explicitly
+    config.write_behind_interval = std::chrono::hours(1);
+
+    Database::registerModel<TestCounter>();
+    Database db{config};
+    const std::string table{TestCounter::tableName()};
+    if (!db.createTable<TestCounter>() || !db.truncateTable(table))
+    {
+        fmt::print("failed to create the test table: {}\n", db.lastErrorMessage());
+        return EXIT_FAILURE;
+    }
+
+    test_save_while_holding_a_row_lock(db, table);
+    test_rolled_back_delete(db);
+
+    db.dropTable(table);
+
+    if (failures > 0)
+    {
+        fmt::print("{} checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
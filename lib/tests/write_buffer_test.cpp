@@ -0,0 +1,179 @@
+// Tests of the write-behind buffer of database/write_buffer.hpp.
+// The write function simulates a row lock by blocking on a record.
+
+#include <database/write_buffer.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <condition_variable>
+
+#include <fmt/format.h>
+
+MODEL(Counter)
+{
+    MODEL_DECL(Counter, "counters");
+    MODEL_ATTRIBUTE(hits, std::int64_t);
+
+public:
+    static Counter existing(id_t id, std::int64_t hits)
+    {
+        Counter counter;
+        counter.set_id(id);
+        counter.reset_changed_state();
+        counter.set_hits(hits);
+        return counter;
+    }
+};
+
+Counter::Counter()
+{
+    this->make_model_attribute<std::int64_t>("hits", 0);
+}
+
+Counter::Counter(const Query *query, const Database *db)
+    : Counter()
+{
+    this->construct_default(query);
+}
+
+MODEL_DEFAULT_VALID_IMPL(Counter);
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition))                                                     \
+        {                                                                     \
+            fmt::print("{}:{}: check failed: {}\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                       \
+        }                                                                     \
+    } while (false)
+
+// record whose write blocks until it is released
+struct RowLock
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    Model::id_t id = 0;
+    bool writing = false;
+    bool released = false;
+
+    void wait(const std::vector<Model*> &models)
+    {
+        std::unique_lock lock{this->mutex};
+        for (auto&& model : models)
+        {
+            if (model->id() == this->id)
+            {
+                this->writing = true;
+                this->changed.notify_all();
+                this->changed.wait(lock, [&]{ return this->released; });
+            }
+        }
+    }
+
+    void wait_for_writer()
+    {
+        std::unique_lock lock{this->mutex};
+        this->changed.wait(lock, [&]{ return this->writing; });
+    }
+
+    void release()
+    {
+        const std::lock_guard lock{this->mutex};
+        this->released = true;
+        this->changed.notify_all();
+    }
+};
+
+std::unique_ptr<Model> copy(const Model &model)
+{
+    return std::make_unique<Counter>(static_cast<const Counter&>(model));
+}
+
+void test_take_doesnt_wait_for_other_records()
+{
+    RowLock row;
+    row.id = 2;
+    std::atomic<int> written{0};
+
+    // the batch size of 1 flushes right away
+    WriteBuffer buffer{std::chrono::hours(1), 1, [&](const std::vector<Model*> &models, std::string &) {
+        row.wait(models);
+        written += static_cast<int>(models.size());
+        return true;
+    }};
+    buffer.configure(typeid(Counter), &copy);
+
+    auto locked = Counter::existing(2, 1);
+    CHECK(buffer.add(locked));
+    row.wait_for_writer();
+
+    // record 1 isn't part of the blocked flush
+    auto other = Counter::existing(1, 1);
+    CHECK(buffer.add(other));
+    const auto taken = buffer.take({&other});
+    CHECK(taken.size() == 1);
+
+    // record 2 is taken after its write finished
+    std::atomic<bool> done{false};
+    std::thread taker([&]{
+        const auto taken = buffer.take({&locked});
+        CHECK(taken.empty());
+        done = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!done);
+
+    row.release();
+    taker.join();
+    CHECK(done);
+    CHECK(written == 1);
+}
+
+void test_failed_flush_is_restored()
+{
+    std::atomic<bool> fail{true};
+    WriteBuffer buffer{std::chrono::hours(1), 1000, [&](const std::vector<Model*> &, std::string &error) {
+        if (fail)
+        {
+            error = "failed";
+            return false;
+        }
+        return true;
+    }};
+    buffer.configure(typeid(Counter), &copy);
+
+    auto counter = Counter::existing(1, 1);
+    CHECK(buffer.add(counter));
+
+    std::string error;
+    CHECK(!buffer.flush(error));
+    CHECK(error == "failed");
+    CHECK(buffer.size() == 1);
+
+    const auto taken = buffer.take({&counter});
+    CHECK(taken.size() == 1);
+    CHECK(buffer.size() == 0);
+
+    fail = false;
+}
+
+}
+
+int main()
+{
+    test_take_doesnt_wait_for_other_records();
+    test_failed_flush_is_restored();
+
+    if (failures > 0)
+    {
+        fmt::print("{} checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -11,8 +11,7 @@ namespace utils {
 #define COMPARATOR(type) \
     to_any_comparator<type>([](const type &l, const type &r){ return l == r; })
 
-std::unordered_map<
-    std::type_index, std::function<bool(const std::any&, const std::any&)>>
+TypeRegistry<std::function<bool(const std::any&, const std::any&)>>
     any_comparator {
 
         // default data types
@@ -52,8 +51,9 @@ std::unordered_map<
 
 bool compare_any(const std::any &l, const std::any &r, bool *success)
 {
-    if (const auto it = any_comparator.find(std::type_index(l.type()));
-        it != any_comparator.cend())
+    const auto comparators = any_comparator.snapshot();
+    if (const auto it = comparators->find(std::type_index(l.type()));
+        it != comparators->cend())
     {
         if (success) (*success) = true;
         return it->second(l, r);
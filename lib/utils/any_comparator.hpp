@@ -4,6 +4,9 @@
 #include <typeindex>
 #include <unordered_map>
 
+#include "value.hpp"
+#include "type_registry.hpp"
+
 namespace utils {
 
 template<class T, class F>
@@ -26,8 +29,7 @@ static inline std::pair<const std::type_index, std::function<bool(const std::any
     };
 }
 
-extern std::unordered_map<
-    std::type_index, std::function<bool(const std::any&, const std::any&)>>
+extern TypeRegistry<std::function<bool(const std::any&, const std::any&)>>
     any_comparator;
 
 template<class T, class F>
@@ -50,4 +52,8 @@ inline void register_any_comparator(F const& f)
 // use the success bool parameter
 extern bool compare_any(const std::any &l, const std::any &r, bool *success = nullptr);
 
+// compares two Value objects for equality, values of different types are never equal
+// built-in types are compared directly, user-defined types using compare_any()
+extern bool compare_value(const Value &l, const Value &r, bool *success = nullptr);
+
 }
@@ -7,17 +7,7 @@
 
 #include <QDateTime>
 
-#define QT_FMT(type, func)                                  \
-template<> struct fmt::formatter<type> {                    \
-    constexpr auto parse(format_parse_context &ctx)         \
-    { return ctx.begin(); }                                 \
-    template<typename FormatContext>                        \
-    auto format(const type &var, FormatContext &ctx) {      \
-        return format_to(ctx.out(), "{}", var.func); } }    \
-
-QT_FMT(QDateTime, toString(Qt::ISODate).toStdString());
-QT_FMT(QDate, toString(Qt::ISODate).toStdString());
-QT_FMT(QTime, toString(Qt::ISODate).toStdString());
+#include "qt_formatter.hpp"
 
 namespace utils {
 
@@ -29,8 +19,7 @@ namespace utils {
         return fmt::format("{}", any.value());                                     \
     })
 
-std::unordered_map<
-    std::type_index, std::function<std::string(const std::any&)>>
+TypeRegistry<std::function<std::string(const std::any&)>>
     any_formatter {
 
         // default data types
@@ -55,8 +44,9 @@ std::unordered_map<
 
 const std::string format_any(const std::any &any, bool *success)
 {
-    if (const auto it = any_formatter.find(std::type_index(any.type()));
-        it != any_formatter.cend())
+    const auto formatters = any_formatter.snapshot();
+    if (const auto it = formatters->find(std::type_index(any.type()));
+        it != formatters->cend())
     {
         if (success) (*success) = true;
         return it->second(any);
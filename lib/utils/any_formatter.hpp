@@ -5,6 +5,9 @@
 #include <typeindex>
 #include <unordered_map>
 
+#include "value.hpp"
+#include "type_registry.hpp"
+
 namespace utils {
 
 template<class T, class F>
@@ -27,8 +30,7 @@ static inline std::pair<const std::type_index, std::function<std::string(const s
     };
 }
 
-extern std::unordered_map<
-    std::type_index, std::function<std::string(const std::any&)>>
+extern TypeRegistry<std::function<std::string(const std::any&)>>
     any_formatter;
 
 template<class T, class F>
@@ -41,4 +43,8 @@ inline void register_any_formatter(F const& f)
 // for explicit error handling use the optimal success boolean parameter
 extern const std::string format_any(const std::any &any, bool *success = nullptr);
 
+// formats the given Value object into a std::string using {fmtlib}
+// built-in types are formatted directly, user-defined types using format_any()
+extern const std::string format_value(const Value &value, bool *success = nullptr);
+
 }
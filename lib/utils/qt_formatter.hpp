@@ -0,0 +1,17 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <QDateTime>
+
+#define QT_FMT(type, func)                                  \
+template<> struct fmt::formatter<type> {                    \
+    constexpr auto parse(format_parse_context &ctx)         \
+    { return ctx.begin(); }                                 \
+    template<typename FormatContext>                        \
+    auto format(const type &var, FormatContext &ctx) {      \
+        return format_to(ctx.out(), "{}", var.func); } }    \
+
+QT_FMT(QDateTime, toString(Qt::ISODate).toStdString());
+QT_FMT(QDate, toString(Qt::ISODate).toStdString());
+QT_FMT(QTime, toString(Qt::ISODate).toStdString());
@@ -20,8 +20,7 @@ namespace utils {
             return QVariant();                          \
         return QVariant::fromValue(source.value()); })
 
-std::unordered_map<
-    std::type_index, std::function<QVariant(const std::any&)>>
+TypeRegistry<std::function<QVariant(const std::any&)>>
     qvariant_converter {
 
         // default data types
@@ -64,8 +63,9 @@ std::unordered_map<
 
 QVariant qvariant_from_any(const std::any &any, bool *success)
 {
-    if (const auto it = qvariant_converter.find(std::type_index(any.type()));
-        it != qvariant_converter.cend())
+    const auto converters = qvariant_converter.snapshot();
+    if (const auto it = converters->find(std::type_index(any.type()));
+        it != converters->cend())
     {
         if (success) (*success) = true;
         return it->second(any);
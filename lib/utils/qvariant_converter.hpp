@@ -6,6 +6,9 @@
 
 #include <QVariant>
 
+#include "value.hpp"
+#include "type_registry.hpp"
+
 namespace utils {
 
 template<class T, class F>
@@ -28,8 +31,7 @@ static inline std::pair<const std::type_index, std::function<QVariant(const std:
     };
 }
 
-extern std::unordered_map<
-    std::type_index, std::function<QVariant(const std::any&)>>
+extern TypeRegistry<std::function<QVariant(const std::any&)>>
     qvariant_converter;
 
 template<class T, class F>
@@ -44,4 +46,8 @@ inline void register_qvariant_converter(F const& f)
 // if you need explicit error handling use the optimal success bool parameter
 extern QVariant qvariant_from_any(const std::any &any, bool *success = nullptr);
 
+// takes the value from a Value object and assigns it into a QVariant
+// built-in types are converted directly, user-defined types using qvariant_from_any()
+extern QVariant qvariant_from_value(const Value &value, bool *success = nullptr);
+
 }
@@ -11,8 +11,7 @@ namespace utils {
     to_qvariant_mapper<type>([](type &target, const QVariant &var){ target = var.impl(); }), \
     to_qvariant_mapper<std::optional<type>>([](std::optional<type> &target, const QVariant &var){ target = var.impl(); })
 
-std::unordered_map<
-    std::type_index, std::function<void(std::any&, const QVariant&)>>
+TypeRegistry<std::function<void(std::any&, const QVariant&)>>
     qvariant_mapper {
 
         // default and optional data types
@@ -26,7 +25,7 @@ std::unordered_map<
         MAPPER(std::int8_t, value<std::int8_t>),
         MAPPER(std::int16_t, value<std::int16_t>),
         MAPPER(std::int32_t, value<std::int32_t>),
-        MAPPER(std::int64_t, value<std::int16_t>),
+        MAPPER(std::int64_t, value<std::int64_t>),
         MAPPER(std::string, toString().toStdString),
 
         // Qt specific types
@@ -37,8 +36,9 @@ std::unordered_map<
 
 bool any_from_qvariant(std::any &any, const QVariant &var)
 {
-    if (const auto it = qvariant_mapper.find(std::type_index(any.type()));
-        it != qvariant_mapper.cend())
+    const auto mappers = qvariant_mapper.snapshot();
+    if (const auto it = mappers->find(std::type_index(any.type()));
+        it != mappers->cend())
     {
         it->second(any, var);
         return true;
@@ -6,6 +6,9 @@
 
 #include <QVariant>
 
+#include "value.hpp"
+#include "type_registry.hpp"
+
 namespace utils {
 
 template<class T, class F>
@@ -28,8 +31,7 @@ static inline std::pair<const std::type_index, std::function<void(std::any&, con
     };
 }
 
-extern std::unordered_map<
-    std::type_index, std::function<void(std::any&, const QVariant&)>>
+extern TypeRegistry<std::function<void(std::any&, const QVariant&)>>
     qvariant_mapper;
 
 template<class T, class F>
@@ -45,4 +47,9 @@ inline void register_qvariant_mapper(F const& f)
 // returns false when the data type is unknown and no conversion happened
 extern bool any_from_qvariant(std::any &any, const QVariant &var);
 
+// assigns the QVariant value into a Value object keeping its current type
+// built-in types are converted directly, user-defined types using any_from_qvariant()
+// NULL values reset optional types
+extern bool value_from_qvariant(Value &value, const QVariant &var);
+
 }
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+#include <initializer_list>
+
+namespace utils {
+
+/**
+ * Read-mostly map of type handlers.
+ *
+ * Lookups work on an immutable snapshot and don't need a lock.
+ * Registering a type publishes a new snapshot, lookups which are
+ * already running keep using the previous one.
+ */
+template<typename Function>
+class TypeRegistry final
+{
+public:
+    using map_t = std::unordered_map<std::type_index, Function>;
+    using value_type = typename map_t::value_type;
+    using snapshot_t = std::shared_ptr<const map_t>;
+
+    TypeRegistry(std::initializer_list<value_type> entries)
+        : _snapshot(std::make_shared<const map_t>(entries))
+    {}
+
+    /**
+     * Returns the current snapshot of the registry.
+     */
+    inline snapshot_t snapshot() const
+    { return this->_snapshot.load(std::memory_order_acquire); }
+
+    /**
+     * Registers a new type handler, existing handlers are not replaced.
+     */
+    void insert(value_type entry)
+    {
+        std::lock_guard lock(this->_mutex);
+
+        auto next = std::make_shared<map_t>(*this->_snapshot.load(std::memory_order_relaxed));
+        next->insert(std::move(entry));
+        this->_snapshot.store(std::move(next), std::memory_order_release);
+    }
+
+private:
+    TypeRegistry(const TypeRegistry &other) = delete;
+    TypeRegistry &operator= (const TypeRegistry &other) = delete;
+
+    std::mutex _mutex;
+    std::atomic<snapshot_t> _snapshot;
+};
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <any>
+#include <string>
+#include <variant>
+#include <optional>
+#include <typeinfo>
+#include <type_traits>
+#include <cstdint>
+
+#include <QDateTime>
+
+namespace utils {
+
+/**
+ * Attribute value of a model.
+ *
+ * The built-in data types are stored inline and dispatched with std::visit.
+ * All other types are stored in the std::any alternative and handled by the
+ * runtime registries, see register_qvariant_converter(), register_qvariant_mapper(),
+ * register_any_comparator() and register_any_formatter().
+ */
+using Value = std::variant<
+    // default data types
+    bool,
+    float,
+    double,
+    std::uint8_t,
+    std::uint16_t,
+    std::uint32_t,
+    std::uint64_t,
+    std::int8_t,
+    std::int16_t,
+    std::int32_t,
+    std::int64_t,
+    std::string,
+
+    // optional default data types
+    std::optional<bool>,
+    std::optional<float>,
+    std::optional<double>,
+    std::optional<std::uint8_t>,
+    std::optional<std::uint16_t>,
+    std::optional<std::uint32_t>,
+    std::optional<std::uint64_t>,
+    std::optional<std::int8_t>,
+    std::optional<std::int16_t>,
+    std::optional<std::int32_t>,
+    std::optional<std::int64_t>,
+    std::optional<std::string>,
+
+    // Qt specific types
+    QDateTime,
+    QDate,
+    QTime,
+    std::optional<QDateTime>,
+    std::optional<QDate>,
+    std::optional<QTime>,
+
+    // user-defined types
+    std::any
+>;
+
+template<typename T, typename Variant>
+struct is_variant_alternative : std::false_type {};
+
+template<typename T, typename... Types>
+struct is_variant_alternative<T, std::variant<Types...>> : std::disjunction<std::is_same<T, Types>...> {};
+
+// checks if the given type is stored inline in a Value
+template<typename T>
+inline constexpr bool is_builtin_value_v = is_variant_alternative<T, Value>::value && !std::is_same_v<T, std::any>;
+
+template<typename T>
+struct is_optional : std::false_type {};
+
+template<typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template<typename T>
+inline constexpr bool is_optional_v = is_optional<T>::value;
+
+// wraps the given value into a Value, user-defined types end up in the std::any alternative
+template<typename T>
+inline Value make_value(const T &value)
+{
+    if constexpr (is_builtin_value_v<T>)
+    {
+        return Value{std::in_place_type<T>, value};
+    }
+    else
+    {
+        return Value{std::in_place_type<std::any>, value};
+    }
+}
+
+// returns a pointer to the stored value or nullptr if the Value holds another type
+template<typename T>
+inline const T *value_cast(const Value *value)
+{
+    if constexpr (is_builtin_value_v<T>)
+    {
+        return std::get_if<T>(value);
+    }
+    else
+    {
+        const auto any = std::get_if<std::any>(value);
+        return any ? std::any_cast<T>(any) : nullptr;
+    }
+}
+
+template<typename T>
+inline T *value_cast(Value *value)
+{
+    return const_cast<T*>(value_cast<T>(static_cast<const Value*>(value)));
+}
+
+// returns the type of the stored value
+inline const std::type_info &value_type(const Value &value)
+{
+    return std::visit([](const auto &v) -> const std::type_info& {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, std::any>)
+        {
+            return v.type();
+        }
+        else
+        {
+            return typeid(T);
+        }
+    }, value);
+}
+
+}
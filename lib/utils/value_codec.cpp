@@ -0,0 +1,179 @@
+#include "value_codec.hpp"
+#include "qvariant_converter.hpp"
+#include "qvariant_mapper.hpp"
+#include "any_comparator.hpp"
+#include "any_formatter.hpp"
+#include "qt_formatter.hpp"
+
+#include <utility>
+
+#include <fmt/format.h>
+
+namespace utils {
+
+// built-in type conversions, the std::any alternative uses the registries
+
+template<typename T>
+static inline QVariant to_qvariant(const T &source)
+{
+    if constexpr (is_optional_v<T>)
+    {
+        if (!source.has_value())
+            return QVariant();
+        return to_qvariant(source.value());
+    }
+    else if constexpr (std::is_same_v<T, std::string>)
+    {
+        return QVariant::fromValue(QString::fromStdString(source));
+    }
+    else
+    {
+        return QVariant::fromValue(source);
+    }
+}
+
+template<typename T>
+static inline void assign_qvariant(T &target, const QVariant &var)
+{
+    if constexpr (is_optional_v<T>)
+    {
+        if (var.isNull())
+        {
+            target.reset();
+            return;
+        }
+        typename T::value_type value{};
+        assign_qvariant(value, var);
+        target = std::move(value);
+    }
+    else if constexpr (std::is_same_v<T, std::string>)
+    {
+        target = var.toString().toStdString();
+    }
+    else
+    {
+        target = var.value<T>();
+    }
+}
+
+template<typename T>
+static inline std::string format(const T &value)
+{
+    if constexpr (is_optional_v<T>)
+    {
+        if (!value.has_value())
+            return std::string{"{NULL}"};
+        return format(value.value());
+    }
+    else
+    {
+        return fmt::format("{}", value);
+    }
+}
+
+// the codec of an alternative is only called with values holding that alternative
+
+template<typename T>
+static QVariant codec_to_qvariant(const Value &value, bool *success)
+{
+    const auto &source = *std::get_if<T>(&value);
+    if constexpr (std::is_same_v<T, std::any>)
+    {
+        return qvariant_from_any(source, success);
+    }
+    else
+    {
+        if (success) (*success) = true;
+        return to_qvariant(source);
+    }
+}
+
+template<typename T>
+static bool codec_from_qvariant(Value &value, const QVariant &var)
+{
+    auto &target = *std::get_if<T>(&value);
+    if constexpr (std::is_same_v<T, std::any>)
+    {
+        return any_from_qvariant(target, var);
+    }
+    else
+    {
+        assign_qvariant(target, var);
+        return true;
+    }
+}
+
+template<typename T>
+static bool codec_compare(const Value &l, const Value &r, bool *success)
+{
+    // values of different types are never equal
+    if (l.index() != r.index())
+    {
+        if (success) (*success) = true;
+        return false;
+    }
+
+    const auto &lhs = *std::get_if<T>(&l);
+    const auto &rhs = *std::get_if<T>(&r);
+    if constexpr (std::is_same_v<T, std::any>)
+    {
+        return compare_any(lhs, rhs, success);
+    }
+    else
+    {
+        if (success) (*success) = true;
+        return lhs == rhs;
+    }
+}
+
+template<typename T>
+static std::string codec_format(const Value &value, bool *success)
+{
+    const auto &source = *std::get_if<T>(&value);
+    if constexpr (std::is_same_v<T, std::any>)
+    {
+        return format_any(source, success);
+    }
+    else
+    {
+        if (success) (*success) = true;
+        return format(source);
+    }
+}
+
+template<std::size_t... I>
+static constexpr std::array<ValueCodec, sizeof...(I)> make_value_codecs(std::index_sequence<I...>)
+{
+    return {ValueCodec{
+        &codec_to_qvariant<std::variant_alternative_t<I, Value>>,
+        &codec_from_qvariant<std::variant_alternative_t<I, Value>>,
+        &codec_compare<std::variant_alternative_t<I, Value>>,
+        &codec_format<std::variant_alternative_t<I, Value>>,
+    }...};
+}
+
+// constant initialized, safe to use during static initialization
+constinit const std::array<ValueCodec, std::variant_size_v<Value>> value_codecs =
+    make_value_codecs(std::make_index_sequence<std::variant_size_v<Value>>{});
+
+QVariant qvariant_from_value(const Value &value, bool *success)
+{
+    return value_codecs[value.index()].to_qvariant(value, success);
+}
+
+bool value_from_qvariant(Value &value, const QVariant &var)
+{
+    return value_codecs[value.index()].from_qvariant(value, var);
+}
+
+bool compare_value(const Value &l, const Value &r, bool *success)
+{
+    return value_codecs[l.index()].compare(l, r, success);
+}
+
+const std::string format_value(const Value &value, bool *success)
+{
+    return value_codecs[value.index()].format(value, success);
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <variant>
+#include <cstddef>
+
+#include <QVariant>
+
+#include "value.hpp"
+
+namespace utils {
+
+/**
+ * Conversion functions for one alternative of Value.
+ *
+ * Model attributes resolve their codec once from the declared attribute
+ * type, see value_codec(). Built-in types are converted directly, the codec
+ * of user-defined types falls back to the runtime registries.
+ */
+struct ValueCodec final
+{
+    QVariant (*to_qvariant)(const Value &value, bool *success);
+    bool (*from_qvariant)(Value &value, const QVariant &var);
+    bool (*compare)(const Value &l, const Value &r, bool *success);
+    std::string (*format)(const Value &value, bool *success);
+};
+
+// codecs indexed by the Value alternative
+extern const std::array<ValueCodec, std::variant_size_v<Value>> value_codecs;
+
+template<typename T, typename Variant>
+struct variant_index;
+
+template<typename T, typename... Types>
+struct variant_index<T, std::variant<Types...>>
+{
+    static constexpr std::size_t value = []{
+        constexpr bool matches[] = {std::is_same_v<T, Types>...};
+        for (std::size_t i = 0; i < sizeof...(Types); ++i)
+        {
+            if (matches[i]) return i;
+        }
+        return sizeof...(Types);
+    }();
+};
+
+// Value alternative which holds the given type
+template<typename T>
+inline constexpr std::size_t value_index_v =
+    variant_index<std::conditional_t<is_builtin_value_v<T>, T, std::any>, Value>::value;
+
+// returns the codec for the given attribute type
+template<typename T>
+inline const ValueCodec &value_codec()
+{
+    return value_codecs[value_index_v<T>];
+}
+
+}